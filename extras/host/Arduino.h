@@ -0,0 +1,110 @@
+/*
+Arduino.h minimal Arduino compatible shim to build the ft817 library on a host (Linux)
+
+Just the bits the library (and the host tools in this folder) need, nothing
+more: basic types, bit macros, millis()/delay(), Print/Stream and a Serial
+object that talks to whatever HostPort is attached to it, see host.h
+
+*/
+
+#ifndef HOST_ARDUINO_h
+#define HOST_ARDUINO_h
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+typedef uint8_t byte;
+typedef bool boolean;
+typedef uint16_t word;
+
+#define HIGH		0x1
+#define LOW			0x0
+
+#define DEC			10
+#define HEX			16
+#define OCT			8
+#define BIN			2
+
+#define SERIAL_8N1	0x06
+#define SERIAL_8N2	0x0E
+
+// no flash/ram split on the host
+#define PROGMEM
+#define PSTR(s)					(s)
+#define F(s)					(s)
+#define pgm_read_byte(addr)		(*(const uint8_t *)(addr))
+#define pgm_read_word(addr)		(*(const uint16_t *)(addr))
+#define pgm_read_dword(addr)	(*(const uint32_t *)(addr))
+#define strcmp_P				strcmp
+#define strcasecmp_P			strcasecmp
+#define memcpy_P				memcpy
+
+#define bitRead(value, bit)		(((value) >> (bit)) & 0x01)
+#define bitSet(value, bit)		((value) |= (1UL << (bit)))
+#define bitClear(value, bit)	((value) &= ~(1UL << (bit)))
+#define bitWrite(value, bit, bitvalue)	((bitvalue) ? bitSet(value, bit) : bitClear(value, bit))
+#define constrain(amt, low, high)	((amt) < (low) ? (low) : ((amt) > (high) ? (high) : (amt)))
+
+// time, 32 bits wide as in the MCU, see host.h for the clock control
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+
+class Print
+{
+	public:
+		virtual ~Print() { }
+		virtual size_t write(uint8_t data) = 0;
+		virtual size_t write(const uint8_t *data, size_t size);
+		size_t write(const char *str) { return write((const uint8_t *)str, strlen(str)); }
+
+		size_t print(const char *str) { return write(str); }
+		size_t print(char c) { return write((uint8_t)c); }
+		size_t print(unsigned long n, int base = DEC);
+		size_t print(long n, int base = DEC);
+		size_t print(unsigned int n, int base = DEC) { return print((unsigned long)n, base); }
+		size_t print(int n, int base = DEC) { return print((long)n, base); }
+		size_t print(unsigned char n, int base = DEC) { return print((unsigned long)n, base); }
+		size_t println() { return write("\r\n"); }
+		template <typename T> size_t println(T value) { size_t n = print(value); return n + println(); }
+		template <typename T> size_t println(T value, int base) { size_t n = print(value, base); return n + println(); }
+};
+
+class Stream : public Print
+{
+	public:
+		virtual int available() = 0;
+		virtual int read() = 0;
+		virtual int peek() = 0;
+		virtual void flush() { }
+};
+
+class HostPort;
+
+class HardwareSerial : public Stream
+{
+	public:
+		HardwareSerial();
+		void attach(HostPort *p);		// route this serial to a host port, NULL to detach
+		HostPort *port() { return hport; }
+		void begin(unsigned long baud, byte config = SERIAL_8N1);
+		void end() { }
+		int available();
+		int read();
+		int peek();
+		void flush();
+		size_t write(uint8_t data);
+		using Print::write;
+		operator bool() { return true; }
+
+	private:
+		HostPort *hport;
+};
+
+extern HardwareSerial Serial;
+
+#endif
@@ -0,0 +1,125 @@
+/*
+async-demo.cpp concurrent coroutines sharing one link vs the blocking calls
+
+Runs the same work twice against the simulated radio on the virtual clock:
+first call after call with the blocking library, then as five concurrent
+coroutines on a FT817Loop (S meter/TX polling, frequency changes, and the
+keyer, break-in and narrow toggles, each one checking its own results).
+Reports the time on the wire of each run.
+
+	async-demo [rounds]
+
+Exits with 1 if any result does not match what was done.
+
+*/
+
+#include <stdio.h>
+#include "host.h"
+#include "simradio.h"
+#include "async.h"
+#include "ft817.h"
+
+static unsigned long failures = 0;
+
+static FT817Task<void> meters(FT817Async &rig, SimRadio &sim, int rounds)
+{
+	for (int i = 0; i < rounds * 4; i++)
+	{
+		if ((co_await rig.getSMeter()) != sim.smeter) { failures++; }
+		if ((co_await rig.chkTX()) != sim.ptt) { failures++; }
+	}
+}
+
+static FT817Task<void> tuning(FT817Async &rig, int rounds)
+{
+	for (int i = 0; i < rounds; i++)
+	{
+		unsigned long f = 1400000 + i * 100, got;
+		co_await rig.setFreq(f);
+		if (!co_await rig.getFreqMode(&got) || got != f) { failures++; }
+	}
+}
+
+// toggle a settings bit and read it back, "before" is the initial state
+static FT817Task<void> toggler(FT817Async &rig, int rounds, bool before,
+	FT817Task<bool> (FT817Async::*toggle)(), FT817Task<bool> (FT817Async::*get)(bool *))
+{
+	for (int i = 0; i < rounds; i++)
+	{
+		bool now;
+		if (!co_await (rig.*toggle)()) { failures++; }
+		if (!co_await (rig.*get)(&now) || now == before) { failures++; }
+		before = now;
+	}
+}
+
+static void blocking(FT817 &radio, SimRadio &sim, int rounds)
+{
+	bool k = bitRead(sim.eeprom[0x58], 4);
+	bool b = bitRead(sim.eeprom[0x58], 5);
+	bool n = bitRead(sim.eeprom[sim.vfoAddr(sim.vfo()) + 1], 4);
+
+	for (int i = 0; i < rounds; i++)
+	{
+		for (int m = 0; m < 4; m++)
+		{
+			if (radio.getSMeter() != sim.smeter) { failures++; }
+			if (radio.chkTX() != sim.ptt) { failures++; }
+		}
+
+		unsigned long f = 1400000 + i * 100;
+		radio.setFreq(f);
+		if (radio.getFreqMode() != f) { failures++; }
+
+		if (!radio.toggleKeyer() || radio.getKeyer() == k) { failures++; }
+		k = !k;
+
+		if (!radio.toggleBreakIn() || radio.getBreakIn() == b) { failures++; }
+		b = !b;
+
+		if (!radio.toggleNar() || radio.getNar() == n) { failures++; }
+		n = !n;
+	}
+}
+
+int main(int argc, char **argv)
+{
+	int rounds = argc > 1 ? atoi(argv[1]) : 20;
+
+	SimRadio sim;
+	sim.smeter = 9;
+	host::clockVirtual();
+
+	// call after call
+	FT817 radio;
+	Serial.attach(&sim);
+	radio.begin(9600);
+	uint64_t t0 = host::clockUs();
+	unsigned long f0 = sim.frames;
+	blocking(radio, sim, rounds);
+	uint64_t seq = host::clockUs() - t0;
+	unsigned long seqFrames = sim.frames - f0;
+
+	// concurrent
+	sim.reset();
+	sim.smeter = 9;
+	FT817Loop loop(sim);
+	FT817Async rig(loop);
+	t0 = host::clockUs();
+	f0 = sim.frames;
+	loop.spawn(meters(rig, sim, rounds));
+	loop.spawn(tuning(rig, rounds));
+	loop.spawn(toggler(rig, rounds, bitRead(sim.eeprom[0x58], 4), &FT817Async::toggleKeyer, &FT817Async::getKeyer));
+	loop.spawn(toggler(rig, rounds, bitRead(sim.eeprom[0x58], 5), &FT817Async::toggleBreakIn, &FT817Async::getBreakIn));
+	loop.spawn(toggler(rig, rounds, bitRead(sim.eeprom[sim.vfoAddr(sim.vfo()) + 1], 4), &FT817Async::toggleNar, &FT817Async::getNar));
+	loop.run();
+	uint64_t conc = host::clockUs() - t0;
+
+	printf("%d rounds\n", rounds);
+	printf("blocking calls:         %8.1f s on the wire, %lu frames\n", seq / 1e6, seqFrames);
+	printf("concurrent coroutines:  %8.1f s on the wire, %lu frames, %lu timeouts\n",
+		conc / 1e6, sim.frames - f0, loop.timeouts);
+	printf("%lu failures\n", failures);
+
+	return failures ? 1 : 0;
+}
@@ -0,0 +1,476 @@
+/*
+async.cpp C++20 coroutine API for host builds
+
+*/
+
+#include "async.h"
+
+/****** EVENT LOOP ********/
+
+FT817Loop::FT817Loop(HostPort &port, unsigned long baud) : port(port)
+{
+	frames = 0;
+	timeouts = 0;
+	current = nullptr;
+	port.begin(baud);
+}
+
+void FT817Loop::Exchange::await_suspend(std::coroutine_handle<> caller)
+{
+	h = caller;
+	loop.queued.push_back(this);
+}
+
+void FT817Loop::Sleep::await_suspend(std::coroutine_handle<> caller)
+{
+	loop.timers.push_back(Timer{(uint32_t)millis(), ms, caller});
+}
+
+void FT817Loop::send()
+{
+	current = queued.front();
+	queued.pop_front();
+
+	// drop any leftover byte, the same as FT817::sendFrame()
+	while (port.read() >= 0) { ; }
+	for (byte i=0; i<5; i++)
+	{
+		port.write(current->frame[i]);
+	}
+
+	current->start = millis();
+	frames++;
+}
+
+void FT817Loop::receive()
+{
+	while (current->received < current->count && port.available() > 0)
+	{
+		current->reply[current->received++] = port.read();
+	}
+
+	bool expired = (uint32_t)(millis() - current->start) >= FT817_TIMEOUT;
+	if (current->received < current->count && !expired) { return; }
+
+	if (current->received < current->count)
+	{
+		// pad it as a timed out read in the library does
+		for (byte i=current->received; i<current->count; i++) { current->reply[i] = 0xFF; }
+		timeouts++;
+	}
+
+	ready.push_back(current->h);
+	current = nullptr;
+}
+
+bool FT817Loop::dispatch()
+{
+	bool progress = true;
+	while (progress)
+	{
+		progress = false;
+
+		// resume what is ready, they will queue frames, timers...
+		while (!ready.empty())
+		{
+			std::coroutine_handle<> h = ready.front();
+			ready.pop_front();
+			h.resume();
+		}
+
+		if (!current && !queued.empty()) { send(); }
+
+		if (current)
+		{
+			receive();
+			progress = !current;
+		}
+
+		uint32_t now = millis();
+		for (size_t i = 0; i < timers.size(); )
+		{
+			if ((uint32_t)(now - timers[i].start) >= timers[i].ms)
+			{
+				ready.push_back(timers[i].h);
+				timers[i] = timers.back();
+				timers.pop_back();
+				progress = true;
+			}
+			else
+			{
+				i++;
+			}
+		}
+	}
+
+	// nobody is waiting for an answer, drop what may come
+	if (!current) { while (port.read() >= 0) { ; } }
+
+	return current || !timers.empty();
+}
+
+int FT817Loop::timeout()
+{
+	if (!ready.empty() || (!current && !queued.empty())) { return 0; }
+
+	uint32_t now = millis();
+	int64_t next = -1;
+	if (current)
+	{
+		next = FT817_TIMEOUT - (int64_t)(uint32_t)(now - current->start);
+	}
+	for (size_t i = 0; i < timers.size(); i++)
+	{
+		int64_t left = (int64_t)timers[i].ms - (uint32_t)(now - timers[i].start);
+		if (next < 0 || left < next) { next = left; }
+	}
+
+	if (next < 0 && (current || !timers.empty())) { return 0; }
+	return (int)next;
+}
+
+bool FT817Loop::runOnce()
+{
+	if (!dispatch()) { return false; }
+
+	// the port is what moves the time forward while waiting: a real one
+	// waits a bit for data, the simulated one jumps the virtual clock
+	port.available();
+	return true;
+}
+
+void FT817Loop::run()
+{
+	while (runOnce()) { ; }
+}
+
+/****** MUTEX ********/
+
+bool FT817Mutex::Lock::await_ready()
+{
+	// take it right away only if nobody is waiting before us
+	if (!mutex.waiters.empty() || mutex.writer) { return false; }
+	if (exclusive)
+	{
+		if (mutex.readers) { return false; }
+		mutex.writer = true;
+	}
+	else
+	{
+		mutex.readers++;
+	}
+	return true;
+}
+
+void FT817Mutex::Lock::await_suspend(std::coroutine_handle<> caller)
+{
+	mutex.waiters.push_back(Waiter{exclusive, caller});
+}
+
+FT817Guard::~FT817Guard()
+{
+	if (mutex) { mutex->unlock(exclusive); }
+}
+
+// release and hand the lock to the next waiters, in order
+void FT817Mutex::unlock(bool exclusive)
+{
+	if (exclusive) { writer = false; } else { readers--; }
+
+	while (!waiters.empty() && !writer)
+	{
+		Waiter &w = waiters.front();
+		if (w.exclusive)
+		{
+			if (readers) { break; }
+			writer = true;
+		}
+		else
+		{
+			readers++;
+		}
+		loop.wake(w.h);
+		waiters.pop_front();
+	}
+}
+
+/****** CALLS ********/
+
+FT817Task<byte> FT817Async::singleCmd(byte cmd, byte p1)
+{
+	byte frame[5];
+	byte reply[1];
+	FT817::frameCmd(frame, cmd, p1);
+	co_await loop.exchange(frame, reply, 1);
+	co_return reply[0];
+}
+
+FT817Task<bool> FT817Async::getFreqMode(unsigned long *freq, byte *mode)
+{
+	FT817Guard g = co_await vfoLock.lock(false);
+
+	byte frame[5];
+	byte reply[5];
+	FT817::frameCmd(frame, CAT_RX_FREQ_CMD);
+	bool full = (co_await loop.exchange(frame, reply, 5)) == 5;
+
+	*freq = FT817::replyFreq(reply);
+	if (mode) { *mode = reply[4]; }
+	co_return full;
+}
+
+FT817Task<void> FT817Async::setFreq(unsigned long freq)
+{
+	FT817Guard g = co_await vfoLock.lock(false);
+
+	byte frame[5];
+	byte reply[1];
+	FT817::frameFreq(frame, freq, CAT_FREQ_SET);
+	co_await loop.exchange(frame, reply, 1);
+}
+
+FT817Task<void> FT817Async::setMode(byte mode)
+{
+	// the same valid modes as FT817::setMode()
+	if (!ft817ValidCmd(CAT_MODE_SET, mode)) { co_return; }
+
+	FT817Guard g = co_await vfoLock.lock(false);
+	co_await singleCmd(CAT_MODE_SET, mode);
+}
+
+FT817Task<byte> FT817Async::getSMeter()
+{
+	byte frame[5];
+	byte reply[1];
+	FT817::frameCmd(frame, CAT_RX_DATA_CMD);
+	co_await loop.exchange(frame, reply, 1);
+	co_return reply[0] & 0x0F;
+}
+
+FT817Task<bool> FT817Async::chkTX()
+{
+	byte frame[5];
+	byte reply[1];
+	FT817::frameCmd(frame, CAT_TX_DATA_CMD);
+	co_await loop.exchange(frame, reply, 1);
+	co_return !(reply[0] & 0x80);	// bit 7 low on TX
+}
+
+// swap the VFO, the caller must hold the VFO lock exclusive
+static FT817Task<void> swapVFO(FT817Async &rig, FT817Loop &loop)
+{
+	co_await rig.singleCmd(CAT_VFO_AB);
+	// mandatory delay to wait for the radio to apply the changes
+	co_await loop.sleep(FT817Traits::vfoSettle);
+}
+
+FT817Task<void> FT817Async::toggleVFO()
+{
+	FT817Guard g = co_await vfoLock.lock(true);
+	co_await swapVFO(*this, loop);
+}
+
+FT817Task<bool> FT817Async::getVFO(bool *vfo)
+{
+	FT817Guard g = co_await vfoLock.lock(false);
+	co_return co_await getBitFromEEPROM(FT817_FIELD_VFO::address, FT817_FIELD_VFO::shift, vfo);
+}
+
+FT817Task<bool> FT817Async::getBandVFO(bool vfo, byte *band)
+{
+	byte data[2];
+	bool valid = co_await readEEPROMRetry(FT817_FIELD_BAND_A::address, data);
+	*band = vfo ? FT817_FIELD_BAND_B::decode(data[0]) : FT817_FIELD_BAND_A::decode(data[0]);
+	co_return valid;
+}
+
+FT817Task<bool> FT817Async::getNar(bool *nar)
+{
+	co_return co_await getBitFromVFO(FT817_FIELD_NAR::address, FT817_FIELD_NAR::shift, nar);
+}
+
+FT817Task<bool> FT817Async::getIPO(bool *ipo)
+{
+	co_return co_await getBitFromVFO(FT817_FIELD_IPO::address, FT817_FIELD_IPO::shift, ipo);
+}
+
+FT817Task<bool> FT817Async::getKeyer(bool *keyer)
+{
+	co_return co_await getBitFromEEPROM(FT817_FIELD_KEYER::address, FT817_FIELD_KEYER::shift, keyer);
+}
+
+FT817Task<bool> FT817Async::getBreakIn(bool *breakIn)
+{
+	co_return co_await getBitFromEEPROM(FT817_FIELD_BREAKIN::address, FT817_FIELD_BREAKIN::shift, breakIn);
+}
+
+FT817Task<bool> FT817Async::toggleNar()
+{
+	co_return co_await toggleBitFromVFO(FT817_FIELD_NAR::address, FT817_FIELD_NAR::shift);
+}
+
+FT817Task<bool> FT817Async::toggleIPO()
+{
+	co_return co_await toggleBitFromVFO(FT817_FIELD_IPO::address, FT817_FIELD_IPO::shift);
+}
+
+FT817Task<bool> FT817Async::toggleKeyer()
+{
+	co_return co_await toggleBitFromEEPROM(FT817_FIELD_KEYER::address, FT817_FIELD_KEYER::shift);
+}
+
+FT817Task<bool> FT817Async::toggleBreakIn()
+{
+	co_return co_await toggleBitFromEEPROM(FT817_FIELD_BREAKIN::address, FT817_FIELD_BREAKIN::shift);
+}
+
+/****** EEPROM HELPERS ********/
+
+// the same as FT817::readEEPROM(), only complete reads are compared
+FT817Task<bool> FT817Async::readEEPROM(unsigned int address, byte *data)
+{
+	byte frame[5];
+	byte reply[2];
+	FT817::frameReadEEPROM(frame, address);
+
+	bool lastFull = false;
+	for (byte i=0; i<FT817_EEPROM_READS; i++)
+	{
+		bool full = (co_await loop.exchange(frame, reply, 2)) == 2;
+		if (lastFull && full && (data[0] == reply[0]) && (data[1] == reply[1]))
+		{
+			co_return true;
+		}
+
+		data[0] = reply[0];
+		data[1] = reply[1];
+		lastFull = full;
+
+		co_await loop.sleep(FT817Traits::eepromReread);	// mandatory delay
+	}
+
+	co_return false;
+}
+
+FT817Task<bool> FT817Async::readEEPROMRetry(unsigned int address, byte *data)
+{
+	for (byte count=0; count<=FT817_RETRIES; count++)
+	{
+		if (co_await readEEPROM(address, data)) { co_return true; }
+	}
+
+	co_return false;
+}
+
+FT817Task<bool> FT817Async::writeEEPROM(unsigned int address, byte data)
+{
+	byte frame[5];
+	byte actual[2];
+	byte reply[1];
+
+	// load the next byte to preserve it
+	if (!co_await readEEPROMRetry(address, actual)) { co_return false; }
+
+	FT817::frameWriteEEPROM(frame, address, data, actual[1]);
+	co_await loop.exchange(frame, reply, 1);
+	co_await loop.sleep(FT817Traits::eepromWrite);
+
+	// read it & check
+	if (!co_await readEEPROMRetry(address, actual)) { co_return false; }
+	co_return actual[0] == data;
+}
+
+FT817Task<bool> FT817Async::calcVFOaddr(unsigned int *address)
+{
+	byte data[2];
+	if (!co_await readEEPROMRetry(FT817_FIELD_VFO::address, data)) { co_return false; }
+	bool vfo = FT817_FIELD_VFO::decode(data[0]);
+
+	byte band;
+	if (!co_await getBandVFO(vfo, &band)) { co_return false; }
+
+	*address = ft817VFOBase(vfo, band);
+	co_return true;
+}
+
+FT817Task<bool> FT817Async::getBitFromEEPROM(unsigned int address, byte rbit, bool *value)
+{
+	byte data[2];
+	if (!co_await readEEPROMRetry(address, data)) { co_return false; }
+	*value = bitRead(data[0], rbit);
+	co_return true;
+}
+
+FT817Task<bool> FT817Async::toggleBitFromEEPROM(unsigned int address, byte rbit)
+{
+	FT817Guard g = co_await eepromLock.lock(true);
+
+	byte data[2];
+	if (!co_await readEEPROMRetry(address, data)) { co_return false; }
+
+	byte newData = data[0];
+	bitWrite(newData, rbit, !bitRead(newData, rbit));
+
+	for (byte count=0; count<=FT817_RETRIES; count++)
+	{
+		if (co_await writeEEPROM(address, newData)) { co_return true; }
+	}
+
+	co_return false;
+}
+
+FT817Task<bool> FT817Async::readFromVFOLocked(signed int offset, unsigned int *address, byte *data)
+{
+	bool valid = false;
+	for (byte count=0; count<=FT817_RETRIES && !valid; count++)
+	{
+		valid = co_await calcVFOaddr(address);
+	}
+	if (!valid) { co_return false; }
+
+	*address += offset;
+	co_return co_await readEEPROMRetry(*address, data);
+}
+
+FT817Task<bool> FT817Async::readFromVFO(signed int offset, unsigned int *address, byte *data)
+{
+	FT817Guard g = co_await vfoLock.lock(false);
+	co_return co_await readFromVFOLocked(offset, address, data);
+}
+
+FT817Task<bool> FT817Async::getBitFromVFO(signed int offset, byte rbit, bool *value)
+{
+	unsigned int address;
+	byte data[2];
+	if (!co_await readFromVFO(offset, &address, data)) { co_return false; }
+	*value = bitRead(data[0], rbit);
+	co_return true;
+}
+
+// the VFO is swapped while writing, so nobody depending on the current VFO
+// can run in between: the lock is taken exclusive for the whole sequence
+FT817Task<bool> FT817Async::toggleBitFromVFO(signed int offset, byte rbit)
+{
+	FT817Guard g = co_await vfoLock.lock(true);
+	FT817Guard e = co_await eepromLock.lock(true);
+
+	unsigned int address;
+	byte data[2];
+	if (!co_await readFromVFOLocked(offset, &address, data)) { co_return false; }
+
+	byte newData = data[0];
+	bitWrite(newData, rbit, !bitRead(newData, rbit));
+
+	co_await swapVFO(*this, loop);
+
+	bool done = false;
+	for (byte count=0; count<=FT817_RETRIES && !done; count++)
+	{
+		done = co_await writeEEPROM(address, newData);
+	}
+
+	// switch VFO back to target one no matter if success or not
+	co_await swapVFO(*this, loop);
+
+	co_return done;
+}
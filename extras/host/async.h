@@ -0,0 +1,320 @@
+/*
+async.h C++20 coroutine API for host builds
+
+Every CAT exchange is a suspension point: a coroutine sends a frame and
+sleeps until the reply is in (or the timeout expires), while the others
+keep the link busy. Many logical operations, each written as plain
+sequential code, share one link and overlap their waits (the 20 ms between
+EEPROM reads, the 200 ms after a VFO swap, ...).
+
+	FT817Loop loop(sim);			// any HostPort
+	FT817Async rig(loop);
+
+	FT817Task<void> job(FT817Async &rig)
+	{
+		bool nar;
+		if (co_await rig.getNar(&nar)) { ... }
+		co_await rig.toggleKeyer();
+	}
+
+	loop.spawn(job(rig));
+	loop.spawn(other(rig));
+	loop.run();						// until all are done
+
+FT817Loop
+	The event loop: one frame on the wire at a time (in order of arrival)
+	and timers.
+
+FT817Async
+	The library calls and its EEPROM helpers as coroutines, the same frames,
+	delays and retry policy (FT817_* defines in ft817.h). Concurrent calls
+	do not share a validity flag, so the EEPROM based ones return the
+	validity and give the value in an out parameter.
+
+	Two FT817Mutex keep the concurrent calls right: the sequences that swap
+	the VFO take the VFO lock exclusive and the calls that depend on the
+	current VFO take it shared, the rest (meters, TX status, the settings
+	bits) run at any time; the EEPROM read-modify-writes are serialized by
+	the EEPROM lock, so two toggles of bits in the same byte do not undo
+	each other.
+
+Everything runs on the thread calling run() (or dispatch()), no locking
+needed.
+
+*/
+
+#ifndef HOST_ASYNC_h
+#define HOST_ASYNC_h
+
+#include <coroutine>
+#include <deque>
+#include <exception>
+#include <vector>
+#include "host.h"
+#include "ft817.h"
+
+/****** TASK ********/
+
+template <class T> class FT817Task;
+
+template <class T>
+struct FT817PromiseBase
+{
+	std::coroutine_handle<> continuation;
+	bool detached = false;
+
+	std::suspend_always initial_suspend() noexcept { return {}; }
+
+	struct Final
+	{
+		bool await_ready() noexcept { return false; }
+		template <class P>
+		std::coroutine_handle<> await_suspend(std::coroutine_handle<P> h) noexcept
+		{
+			FT817PromiseBase &p = h.promise();
+			if (p.continuation) { return p.continuation; }
+			if (p.detached) { h.destroy(); }
+			return std::noop_coroutine();
+		}
+		void await_resume() noexcept { }
+	};
+
+	Final final_suspend() noexcept { return {}; }
+	void unhandled_exception() { std::terminate(); }
+};
+
+template <class T>
+struct FT817Promise : FT817PromiseBase<T>
+{
+	T value;
+	FT817Task<T> get_return_object();
+	void return_value(T v) { value = v; }
+	T result() { return value; }
+};
+
+template <>
+struct FT817Promise<void> : FT817PromiseBase<void>
+{
+	FT817Task<void> get_return_object();
+	void return_void() { }
+	void result() { }
+};
+
+// a lazy coroutine: it starts when awaited or spawned on a loop
+template <class T>
+class FT817Task
+{
+	public:
+		typedef FT817Promise<T> promise_type;
+		typedef std::coroutine_handle<promise_type> Handle;
+
+		explicit FT817Task(Handle h) : h(h) { }
+		FT817Task(FT817Task &&o) : h(o.h) { o.h = nullptr; }
+		FT817Task(const FT817Task &) = delete;
+		~FT817Task() { if (h) { h.destroy(); } }
+
+		bool await_ready() { return false; }
+		std::coroutine_handle<> await_suspend(std::coroutine_handle<> caller)
+		{
+			h.promise().continuation = caller;
+			return h;
+		}
+		T await_resume() { return h.promise().result(); }
+
+		// hand the coroutine over, it will free itself when done
+		Handle detach()
+		{
+			Handle d = h;
+			h = nullptr;
+			d.promise().detached = true;
+			return d;
+		}
+
+	private:
+		Handle h;
+};
+
+template <class T>
+FT817Task<T> FT817Promise<T>::get_return_object()
+{
+	return FT817Task<T>(std::coroutine_handle<FT817Promise<T>>::from_promise(*this));
+}
+
+inline FT817Task<void> FT817Promise<void>::get_return_object()
+{
+	return FT817Task<void>(std::coroutine_handle<FT817Promise<void>>::from_promise(*this));
+}
+
+/****** EVENT LOOP ********/
+
+class FT817Loop
+{
+	public:
+		FT817Loop(HostPort &port, unsigned long baud = 9600);
+
+		// co_await exchange(frame, reply, count): send the frame and collect
+		// up to count reply bytes, gives the count really received
+		struct Exchange
+		{
+			FT817Loop &loop;
+			const byte *frame;
+			byte *reply;
+			byte count;
+			byte received;
+			uint32_t start;
+			std::coroutine_handle<> h;
+
+			bool await_ready() { return false; }
+			void await_suspend(std::coroutine_handle<> caller);
+			byte await_resume() { return received; }
+		};
+		Exchange exchange(const byte *frame, byte *reply, byte count)
+		{
+			return Exchange{*this, frame, reply, count, 0, 0, nullptr};
+		}
+
+		// co_await sleep(ms)
+		struct Sleep
+		{
+			FT817Loop &loop;
+			uint32_t ms;
+
+			bool await_ready() { return ms == 0; }
+			void await_suspend(std::coroutine_handle<> caller);
+			void await_resume() { }
+		};
+		Sleep sleep(uint32_t ms) { return Sleep{*this, ms}; }
+
+		template <class T>
+		void spawn(FT817Task<T> &&task) { ready.push_back(task.detach()); }
+		void wake(std::coroutine_handle<> h) { ready.push_back(h); }
+
+		bool runOnce();				// one step, false when there is nothing left to do
+		void run();					// until there is nothing left to do
+
+		// for an external event loop (see epoll.h): do all that can be done
+		// without waiting, then wait for the port or timeout() ms
+		bool dispatch();			// false when there is nothing left to do
+		int timeout();				// ms to the next deadline, 0 if there is work now, -1 if idle
+
+		// stats
+		unsigned long frames;		// frames sent
+		unsigned long timeouts;		// exchanges with a short reply
+
+	private:
+		struct Timer
+		{
+			uint32_t start;
+			uint32_t ms;
+			std::coroutine_handle<> h;
+		};
+
+		void send();				// put the next exchange on the wire
+		void receive();				// collect the reply of the one on the wire
+
+		HostPort &port;
+		std::deque<std::coroutine_handle<>> ready;
+		std::deque<Exchange *> queued;
+		Exchange *current;
+		std::vector<Timer> timers;
+};
+
+class FT817Mutex;
+
+// holds a FT817Mutex, released when it goes out of scope
+class FT817Guard
+{
+	public:
+		FT817Guard(FT817Mutex *mutex, bool exclusive) : mutex(mutex), exclusive(exclusive) { }
+		FT817Guard(FT817Guard &&o) : mutex(o.mutex), exclusive(o.exclusive) { o.mutex = nullptr; }
+		FT817Guard(const FT817Guard &) = delete;
+		~FT817Guard();
+
+	private:
+		FT817Mutex *mutex;
+		bool exclusive;
+};
+
+// a shared / exclusive lock for the coroutines of a loop, granted in order
+//
+//	FT817Guard g = co_await mutex.lock(true);
+class FT817Mutex
+{
+	public:
+		FT817Mutex(FT817Loop &loop) : loop(loop), readers(0), writer(false) { }
+
+		struct Lock
+		{
+			FT817Mutex &mutex;
+			bool exclusive;
+
+			bool await_ready();
+			void await_suspend(std::coroutine_handle<> caller);
+			FT817Guard await_resume() { return FT817Guard(&mutex, exclusive); }
+		};
+		Lock lock(bool exclusive) { return Lock{*this, exclusive}; }
+
+	private:
+		friend class FT817Guard;
+
+		struct Waiter
+		{
+			bool exclusive;
+			std::coroutine_handle<> h;
+		};
+
+		void unlock(bool exclusive);
+
+		FT817Loop &loop;
+		unsigned int readers;
+		bool writer;
+		std::deque<Waiter> waiters;
+};
+
+/****** CALLS ********/
+
+class FT817Async
+{
+	public:
+		FT817Async(FT817Loop &loop) : loop(loop), vfoLock(loop), eepromLock(loop) { }
+
+		// CAT
+		FT817Task<byte> singleCmd(byte cmd, byte p1 = 0);
+		FT817Task<bool> getFreqMode(unsigned long *freq, byte *mode = nullptr);
+		FT817Task<void> setFreq(unsigned long freq);
+		FT817Task<void> setMode(byte mode);
+		FT817Task<byte> getSMeter();
+		FT817Task<bool> chkTX();
+		FT817Task<void> toggleVFO();
+
+		// EEPROM based, true if valid
+		FT817Task<bool> getVFO(bool *vfo);
+		FT817Task<bool> getBandVFO(bool vfo, byte *band);
+		FT817Task<bool> getNar(bool *nar);
+		FT817Task<bool> getIPO(bool *ipo);
+		FT817Task<bool> getKeyer(bool *keyer);
+		FT817Task<bool> getBreakIn(bool *breakIn);
+		FT817Task<bool> toggleNar();
+		FT817Task<bool> toggleIPO();
+		FT817Task<bool> toggleKeyer();
+		FT817Task<bool> toggleBreakIn();
+
+		// the EEPROM helpers
+		FT817Task<bool> readEEPROM(unsigned int address, byte *data);
+		FT817Task<bool> readEEPROMRetry(unsigned int address, byte *data);
+		FT817Task<bool> writeEEPROM(unsigned int address, byte data);
+		FT817Task<bool> calcVFOaddr(unsigned int *address);
+		FT817Task<bool> getBitFromEEPROM(unsigned int address, byte rbit, bool *value);
+		FT817Task<bool> toggleBitFromEEPROM(unsigned int address, byte rbit);
+		FT817Task<bool> readFromVFO(signed int offset, unsigned int *address, byte *data);
+		FT817Task<bool> getBitFromVFO(signed int offset, byte rbit, bool *value);
+		FT817Task<bool> toggleBitFromVFO(signed int offset, byte rbit);
+
+	private:
+		FT817Task<bool> readFromVFOLocked(signed int offset, unsigned int *address, byte *data);
+		FT817Loop &loop;
+		FT817Mutex vfoLock;			// exclusive while the VFO is swapped
+		FT817Mutex eepromLock;		// exclusive during an EEPROM read-modify-write
+};
+
+#endif
@@ -0,0 +1,145 @@
+/*
+codec-bench.cpp the frequency BCD codec vs the classic %10 & /10 way
+
+Checks ft817EncodeFreq() & ft817DecodeFreq() against the classic code the
+library used before, over the whole 0 - 99,999,999 range (round trip and
+bytes), a sweep above it and random (not BCD) bytes to decode, plus the
+compile time ft817BCD(). Then it times both ways over the whole range.
+
+	codec-bench [random decodes]
+
+Exits with 1 on any mismatch. On the host the compiler turns the classic
+/10 into multiplies, so the gap here is smaller than on the AVR, where the
+divisions are software routines.
+
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "ft817codec.h"
+
+// the classic way, as the library had it
+__attribute__((noinline)) static void classicEncode(unsigned long f, byte *bcd)
+{
+	unsigned char a;
+	for (int i = 3; i >= 0; i--)
+	{
+		a = f % 10;
+		f /= 10;
+		a |= (f % 10) << 4;
+		f /= 10;
+		bcd[i] = a;
+	}
+}
+
+__attribute__((noinline)) static unsigned long classicDecode(const byte *bcd)
+{
+	unsigned long f = 0;
+	for (byte i = 0; i < 4; i++)
+	{
+		f *= 10;
+		f += bcd[i] >> 4;
+		f *= 10;
+		f += bcd[i] & 0x0f;
+	}
+	return f;
+}
+
+static_assert(ft817BCD(0) == 0, "ft817BCD");
+static_assert(ft817BCD(1407000) == 0x01407000, "ft817BCD");
+static_assert(ft817BCD(99999999) == 0x99999999, "ft817BCD");
+static_assert(ft817BCD(123456789) == 0x23456789, "ft817BCD keeps the lower 8 digits");
+
+static double now()
+{
+	struct timespec t;
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	return t.tv_sec + t.tv_nsec / 1e9;
+}
+
+static const unsigned long range = 100000000UL;
+
+int main(int argc, char **argv)
+{
+	unsigned long randoms = argc > 1 ? strtoul(argv[1], NULL, 10) : 100000000UL;
+	unsigned long failures = 0;
+	byte a[4], b[4];
+
+	// the whole range, bytes & round trip
+	for (unsigned long f = 0; f < range; f++)
+	{
+		ft817EncodeFreq(f, a);
+		classicEncode(f, b);
+		uint32_t bcd = ((uint32_t)a[0] << 24) | ((uint32_t)a[1] << 16) | (a[2] << 8) | a[3];
+		if (a[0] != b[0] || a[1] != b[1] || a[2] != b[2] || a[3] != b[3] ||
+			ft817DecodeFreq(a) != f || bcd != ft817BCD(f))
+		{
+			if (failures++ < 10) { printf("mismatch at %lu\n", f); }
+		}
+	}
+	printf("0 - %lu: encode, decode & round trip checked\n", range - 1);
+
+	// bigger ones keep the lower 8 digits
+	for (uint32_t f = range; f >= range; f += 9973)
+	{
+		ft817EncodeFreq(f, a);
+		classicEncode(f, b);
+		if (a[0] != b[0] || a[1] != b[1] || a[2] != b[2] || a[3] != b[3])
+		{
+			if (failures++ < 10) { printf("mismatch at %lu\n", (unsigned long)f); }
+		}
+	}
+	printf("%lu - 2^32: encode checked (a step of 9973)\n", range);
+
+	// any 4 bytes (not BCD digits) decode the same as before
+	uint32_t x = 2463534242UL;
+	for (unsigned long i = 0; i < randoms; i++)
+	{
+		x ^= x << 13;
+		x ^= x >> 17;
+		x ^= x << 5;
+		a[0] = x >> 24; a[1] = x >> 16; a[2] = x >> 8; a[3] = x;
+		if (ft817DecodeFreq(a) != classicDecode(a))
+		{
+			if (failures++ < 10) { printf("decode mismatch at 0x%08lx\n", (unsigned long)x); }
+		}
+	}
+	printf("%lu random 4 bytes: decode checked\n", randoms);
+
+	// a whole frame at compile time
+	const byte frame[5] = FT817_FREQ_FRAME(1407000, 0x01);
+	if (frame[0] != 0x01 || frame[1] != 0x40 || frame[2] != 0x70 || frame[3] != 0x00 || frame[4] != 0x01)
+	{
+		failures++;
+		printf("FT817_FREQ_FRAME mismatch\n");
+	}
+
+	// timing, the whole range each
+	unsigned long sum = 0;
+	double t0 = now();
+	for (unsigned long f = 0; f < range; f++) { classicEncode(f, a); sum += a[0] ^ a[3]; }
+	double t1 = now();
+	for (unsigned long f = 0; f < range; f++) { ft817EncodeFreq(f, a); sum += a[0] ^ a[3]; }
+	double t2 = now();
+	for (unsigned long f = 0; f < range; f++)
+	{
+		a[0] = f >> 24; a[1] = f >> 16; a[2] = f >> 8; a[3] = f;
+		sum += classicDecode(a);
+	}
+	double t3 = now();
+	for (unsigned long f = 0; f < range; f++)
+	{
+		a[0] = f >> 24; a[1] = f >> 16; a[2] = f >> 8; a[3] = f;
+		sum += ft817DecodeFreq(a);
+	}
+	double t4 = now();
+
+	printf("\n%-8s %12s %12s\n", "ns/call", "classic", "codec");
+	printf("%-8s %12.2f %12.2f\n", "encode", (t1 - t0) * 1e9 / range, (t2 - t1) * 1e9 / range);
+	printf("%-8s %12.2f %12.2f\n", "decode", (t3 - t2) * 1e9 / range, (t4 - t3) * 1e9 / range);
+	printf("(checksum %lu)\n", sum);
+
+	printf("\n%lu mismatches\n", failures);
+	return failures ? 1 : 0;
+}
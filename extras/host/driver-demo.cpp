@@ -0,0 +1,115 @@
+/*
+driver-demo.cpp many threads sharing one radio through FT817Driver
+
+A writer thread tunes the radio and reads the frequency back after every
+change (it must always see its own write), while the other threads fire
+bursts of reads (S meter, freq/mode, TX status, VFO) without waiting for
+them. At the end it reports what reached the wire and how much the read
+deduplication saved.
+
+	driver-demo [threads] [bursts]			simulated radio, virtual clock
+	driver-demo [threads] [bursts] /dev/ttyUSB0	a real radio, 9600 bps
+
+Exits with 1 if the writer ever reads back something else than it wrote or
+a read against the simulated radio is not valid.
+
+*/
+
+#include <stdio.h>
+#include <time.h>
+#include <vector>
+#include "host.h"
+#include "simradio.h"
+#include "serialport.h"
+#include "driver.h"
+
+static std::atomic<unsigned long> failures(0);
+
+static void writer(FT817Driver &rig, int bursts)
+{
+	for (int i = 0; i < bursts; i++)
+	{
+		unsigned long f = 1400000 + i * 10;
+		rig.setFreq(f);
+		FT817Reading r = rig.read(FT817_READ_FREQ_MODE).get();
+		if (!r.valid || r.value != f) { failures++; }
+	}
+}
+
+static void poller(FT817Driver &rig, int bursts)
+{
+	static const FT817Read kinds[] = {
+		FT817_READ_SMETER, FT817_READ_FREQ_MODE, FT817_READ_TX, FT817_READ_VFO};
+
+	for (int i = 0; i < bursts; i++)
+	{
+		std::vector<std::future<FT817Reading>> burst;
+		for (size_t k = 0; k < sizeof(kinds) / sizeof(kinds[0]); k++)
+		{
+			burst.push_back(rig.read(kinds[k]));
+		}
+		for (size_t k = 0; k < burst.size(); k++)
+		{
+			if (!burst[k].get().valid) { failures++; }
+		}
+	}
+}
+
+int main(int argc, char **argv)
+{
+	int threads = argc > 1 ? atoi(argv[1]) : 8;
+	int bursts = argc > 2 ? atoi(argv[2]) : 200;
+	const char *tty = argc > 3 ? argv[3] : NULL;
+
+	SimRadio sim;
+	LinuxSerialPort port;
+	if (tty)
+	{
+		if (!port.open(tty))
+		{
+			perror(tty);
+			return 2;
+		}
+	}
+	else
+	{
+		host::clockVirtual();
+	}
+
+	struct timespec w0, w1;
+	clock_gettime(CLOCK_MONOTONIC, &w0);
+	uint64_t t0 = host::clockUs();
+	FT817DriverStats s;
+	{
+		FT817Driver rig(tty ? (HostPort &)port : (HostPort &)sim);
+
+		std::vector<std::thread> pool;
+		pool.push_back(std::thread(writer, std::ref(rig), bursts));
+		for (int i = 1; i < threads; i++)
+		{
+			pool.push_back(std::thread(poller, std::ref(rig), bursts));
+		}
+		for (size_t i = 0; i < pool.size(); i++) { pool[i].join(); }
+
+		s = rig.stats();
+	}
+	uint64_t link = host::clockUs() - t0;
+	clock_gettime(CLOCK_MONOTONIC, &w1);
+	double wall = (w1.tv_sec - w0.tv_sec) * 1000.0 + (w1.tv_nsec - w0.tv_nsec) / 1e6;
+
+	printf("%d threads, %d bursts each\n", threads, bursts);
+	printf("submitted %lu, sent to the radio %lu, deduplicated %lu (%.1f%%)\n",
+		s.submitted, s.executed, s.deduplicated, 100.0 * s.deduplicated / s.submitted);
+	if (!tty)
+	{
+		printf("radio saw %lu frames, %.1f s on the wire, %.1f ms of real time\n",
+			sim.frames, link / 1e6, wall);
+	}
+	else
+	{
+		printf("%.1f s\n", wall / 1000);
+	}
+	printf("%lu failures\n", (unsigned long)failures);
+
+	return failures ? 1 : 0;
+}
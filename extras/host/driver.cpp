@@ -0,0 +1,248 @@
+/*
+driver.cpp a thread safe driver for the radio on Linux
+
+*/
+
+#include "driver.h"
+#include "metrics.h"
+
+FT817Driver::FT817Driver(HostPort &port, unsigned long baud)
+	: head(&stub), tail(&stub), pending(0), running(true),
+	  submitted(0), executed(0), deduplicated(0)
+{
+	stub.next.store(NULL, std::memory_order_relaxed);
+	stub.read = 0;
+	Serial.attach(&port);
+	radio.begin(baud);
+	radio.setTap(&link);
+	io = std::thread(&FT817Driver::loop, this);
+}
+
+FT817Driver::~FT817Driver()
+{
+	running.store(false);
+	pending.fetch_add(1);
+	pending.notify_one();
+	io.join();
+}
+
+/****** QUEUE ********/
+
+// any thread
+void FT817Driver::push(Node *n)
+{
+	n->next.store(NULL, std::memory_order_relaxed);
+	n->served = false;
+	submitted.fetch_add(1, std::memory_order_relaxed);
+
+	Node *prev = head.exchange(n, std::memory_order_acq_rel);
+	prev->next.store(n, std::memory_order_release);
+
+	// wake the I/O thread only when it may be sleeping
+	if (pending.fetch_add(1, std::memory_order_release) == 0) { pending.notify_one(); }
+}
+
+// I/O thread only, NULL if empty or if a producer is halfway through a push
+FT817Driver::Node *FT817Driver::pop()
+{
+	Node *t = tail;
+	Node *next = t->next.load(std::memory_order_acquire);
+
+	if (t == &stub)
+	{
+		if (!next) { return NULL; }
+		tail = t = next;
+		next = next->next.load(std::memory_order_acquire);
+	}
+
+	if (next)
+	{
+		tail = next;
+		return t;
+	}
+
+	if (t != head.load(std::memory_order_acquire)) { return NULL; }
+
+	// t is the last one, put the stub behind it to be able to take it
+	stub.next.store(NULL, std::memory_order_relaxed);
+	Node *prev = head.exchange(&stub, std::memory_order_acq_rel);
+	prev->next.store(&stub, std::memory_order_release);
+
+	next = t->next.load(std::memory_order_acquire);
+	if (next)
+	{
+		tail = next;
+		return t;
+	}
+
+	return NULL;
+}
+
+void FT817Driver::loop()
+{
+	while (true)
+	{
+		Node *n = pop();
+		if (!n)
+		{
+			if (!running.load() && head.load() == tail) { break; }
+
+			uint32_t p = pending.load(std::memory_order_acquire);
+			if (p == 0) { pending.wait(0, std::memory_order_acquire); }
+			else { std::this_thread::yield(); }
+			continue;
+		}
+
+		if (!n->served) { execute(n); }
+		delete n;
+		pending.fetch_sub(1, std::memory_order_acq_rel);
+	}
+}
+
+void FT817Driver::execute(Node *n)
+{
+	executed.fetch_add(1, std::memory_order_relaxed);
+
+	// taken now, a call can change it
+	FT817Metrics *m = metrics;
+	uint64_t start = 0;
+	if (m)
+	{
+		m->queue(pending.load(std::memory_order_relaxed) - 1);
+		start = host::clockUs();
+	}
+
+	if (!n->read)
+	{
+		// a failed EEPROM read in the call leaves it false; a missing
+		// answer fails a call of CAT commands only, the EEPROM ones retry
+		radio.eepromValidData = true;
+		link.timeouts = 0;
+		link.eeprom = false;
+		bool ok = n->run(radio);
+		bool valid = radio.eepromValidData;
+		ok &= valid && (link.eeprom || !link.timeouts);
+		if (m) { m->operation(0, host::clockUs() - start, ok, !valid); }
+		return;
+	}
+
+	FT817Reading r = doRead(n->read);
+	bool eeprom = n->read >= FT817_READ_VFO;
+	uint64_t took = m ? host::clockUs() - start : 0;
+	if (m) { m->operation(n->read, took, r.valid, eeprom); }
+	n->done(r);
+
+	// answer the same reads already queued, up to the next plain call; the
+	// nodes after the one just popped are still owned by the queue and only
+	// this thread takes them out, so walking them is safe. Each one is an
+	// operation that took as long as the read that answered it
+	for (Node *q = n->next.load(std::memory_order_acquire); q; q = q->next.load(std::memory_order_acquire))
+	{
+		if (q == &stub) { continue; }
+		if (!q->read) { break; }
+		if (q->read == n->read && !q->served)
+		{
+			if (m) { m->operation(q->read, took, r.valid, eeprom); }
+			q->done(r);
+			q->served = true;
+			deduplicated.fetch_add(1, std::memory_order_relaxed);
+		}
+	}
+}
+
+FT817Reading FT817Driver::doRead(byte what)
+{
+	FT817Reading r;
+	r.mode = 0;
+	r.valid = true;
+
+	switch (what)
+	{
+		case FT817_READ_FREQ_MODE:
+		{
+			// getMode() would send a second frame, the reply has both
+			byte frame[5];
+			byte reply[5];
+			FT817::frameCmd(frame, CAT_RX_FREQ_CMD);
+			r.valid = radio.transact(frame, reply, 5) == 5;
+			r.value = FT817::replyFreq(reply);
+			r.mode = reply[4];
+			return r;
+		}
+		case FT817_READ_SMETER:		r.value = radio.getSMeter(); return r;
+		case FT817_READ_PMETER:		r.value = radio.getPMeter(); return r;
+		case FT817_READ_TX:			r.value = radio.chkTX(); return r;
+		case FT817_READ_VFO:		r.value = radio.getVFO(); break;
+		case FT817_READ_BAND_A:		r.value = radio.getBandVFO(0); break;
+		case FT817_READ_BAND_B:		r.value = radio.getBandVFO(1); break;
+		case FT817_READ_DISPLAY:	r.value = radio.getDisplaySelection(); break;
+		case FT817_READ_NAR:		r.value = radio.getNar(); break;
+		case FT817_READ_IPO:		r.value = radio.getIPO(); break;
+		case FT817_READ_BREAKIN:	r.value = radio.getBreakIn(); break;
+		case FT817_READ_KEYER:		r.value = radio.getKeyer(); break;
+		default:
+			r.value = 0;
+			r.valid = false;
+			return r;
+	}
+
+	// EEPROM based
+	r.valid = radio.eepromValidData;
+	return r;
+}
+
+/****** CALLS ********/
+
+std::future<FT817Reading> FT817Driver::read(FT817Read what)
+{
+	auto promise = std::make_shared<std::promise<FT817Reading>>();
+	std::future<FT817Reading> result = promise->get_future();
+	read(what, [promise](const FT817Reading &r) { promise->set_value(r); });
+	return result;
+}
+
+void FT817Driver::read(FT817Read what, std::function<void(const FT817Reading &)> callback)
+{
+	Node *n = new Node;
+	n->read = what;
+	n->done = std::move(callback);
+	push(n);
+}
+
+std::future<void> FT817Driver::setFreq(unsigned long freq)
+{
+	return submit([freq](FT817 &r) { r.setFreq(freq); });
+}
+
+std::future<void> FT817Driver::setMode(byte mode)
+{
+	return submit([mode](FT817 &r) { r.setMode(mode); });
+}
+
+std::future<void> FT817Driver::toggleVFO()
+{
+	return submit([](FT817 &r) { r.toggleVFO(); });
+}
+
+std::future<void> FT817Driver::PTT(bool on)
+{
+	return submit([on](FT817 &r) { r.PTT(on); });
+}
+
+void FT817Driver::setMetrics(FT817Metrics *m)
+{
+	submit([this, m](FT817 &)
+	{
+		link.next = m;
+		metrics = m;
+	}).wait();
+}
+
+FT817DriverStats FT817Driver::stats()
+{
+	FT817DriverStats s;
+	s.submitted = submitted.load(std::memory_order_relaxed);
+	s.executed = executed.load(std::memory_order_relaxed);
+	s.deduplicated = deduplicated.load(std::memory_order_relaxed);
+	return s;
+}
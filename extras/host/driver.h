@@ -0,0 +1,223 @@
+/*
+driver.h a thread safe driver for the radio on Linux
+
+The FT817 object and the serial port are owned by a dedicated I/O thread,
+any number of threads can submit calls to it through a lock free queue and
+get the result as a std::future or in a callback. The calls run one at a
+time, in submission order, so the link is always busy while there is work.
+
+	LinuxSerialPort port;
+	port.open("/dev/ttyUSB0");
+	FT817Driver rig(port);
+
+	FT817Reading fm = rig.read(FT817_READ_FREQ_MODE).get();
+	rig.setFreq(1407000).wait();
+	rig.submit([](FT817 &r) { return r.toggleNar(); }, [](bool ok) { ... });
+
+Reads are deduplicated: when the I/O thread runs a read it also answers
+any other read of the same kind already waiting in the queue, up to the
+next non read call (so a read never gets a value from before a call that
+was submitted ahead of it). Ten threads polling the S meter cost one
+frame on the wire, not ten.
+
+Callbacks run on the I/O thread, keep them short. The library talks to the
+global Serial, so there is one driver per process.
+
+Give it a FT817Metrics (metrics.h) with setMetrics() and every frame, call
+and read it runs is counted & timed there, from the I/O thread, the reads
+answered by another one too. Whether a call failed is taken from the link,
+never from what it returns (a getNar() that says off is not a failure): it
+fails if it leaves eepromValidData false (it's set before each one), if an
+answer or an ack did not come and the call sent no EEPROM frame (those
+retry, eepromValidData tells how they ended) or if it throws. The driver
+keeps the tap of the radio to see that, don't set one from a call: give a
+FT817Trace to the FT817Metrics constructor instead.
+
+The queue is an intrusive multi producer / single consumer linked list
+(D. Vyukov's): a push is one atomic exchange plus a store, the I/O thread
+pops without any atomic read-modify-write and sleeps on an atomic counter
+when there is nothing to do.
+
+*/
+
+#ifndef HOST_DRIVER_h
+#define HOST_DRIVER_h
+
+#include <atomic>
+#include <functional>
+#include <future>
+#include <memory>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include "host.h"
+#include "ft817.h"
+
+class FT817Metrics;
+
+// what a deduplicated read can ask for
+enum FT817Read
+{
+	FT817_READ_FREQ_MODE = 1,	// value: freq in 10' of Hz, mode: mode
+	FT817_READ_SMETER,			// value: 0-15
+	FT817_READ_PMETER,			// value: 0-15
+	FT817_READ_TX,				// value: 1 if on TX
+	FT817_READ_VFO,				// value: 0 = A, 1 = B
+	FT817_READ_BAND_A,			// value: band of VFO A
+	FT817_READ_BAND_B,			// value: band of VFO B
+	FT817_READ_DISPLAY,			// value: display selection
+	FT817_READ_NAR,				// value: 1 if narrow
+	FT817_READ_IPO,				// value: 1 if IPO on
+	FT817_READ_BREAKIN,			// value: 1 if break-in on
+	FT817_READ_KEYER			// value: 1 if keyer on
+};
+
+struct FT817Reading
+{
+	unsigned long value;
+	byte mode;					// only for FT817_READ_FREQ_MODE
+	bool valid;					// false if an EEPROM based read failed (eepromValidData)
+};
+
+struct FT817DriverStats
+{
+	unsigned long submitted;	// calls & reads submitted
+	unsigned long executed;		// calls & reads that went to the radio
+	unsigned long deduplicated;	// reads answered by another read of the same kind
+};
+
+class FT817Driver
+{
+	public:
+		FT817Driver(HostPort &port, unsigned long baud = 9600);
+		~FT817Driver();				// runs what is queued, then stops the I/O thread
+
+		// any sequence of library calls, run on the I/O thread
+		template <class F>
+		auto submit(F fn) -> std::future<decltype(fn(std::declval<FT817 &>()))>;
+		template <class F, class C>
+		void submit(F fn, C callback);
+
+		// deduplicated reads
+		std::future<FT817Reading> read(FT817Read what);
+		void read(FT817Read what, std::function<void(const FT817Reading &)> callback);
+
+		// shortcuts for the usual writes
+		std::future<void> setFreq(unsigned long freq);
+		std::future<void> setMode(byte mode);
+		std::future<void> toggleVFO();
+		std::future<void> PTT(bool on);
+
+		FT817DriverStats stats();
+
+		// count & time the traffic on metrics (NULL to stop), it gets all
+		// the radio tap sees; waits for the queue ahead, not from a callback
+		void setMetrics(FT817Metrics *metrics);
+
+	private:
+		struct Node
+		{
+			std::atomic<Node *> next;
+			byte read;				// a FT817Read, 0 for a plain call
+			bool served;			// answered by a deduplicated read, I/O thread only
+			std::function<bool(FT817 &)> run;	// a plain call, false if it threw
+			std::function<void(const FT817Reading &)> done;
+		};
+
+		// run a plain call & settle its promise, false if it threw
+		template <class R, class F> static bool settle(std::promise<R> &p, F &fn, FT817 &r);
+
+		// the tap of the radio: what the link did in a plain call, all of it
+		// passed on to the metrics if any
+		struct Link : public FT817Tap
+		{
+			FT817Tap *next = NULL;
+			unsigned long timeouts = 0;
+			bool eeprom = false;		// an EEPROM frame went out
+
+			void tx(const byte *frame)
+			{
+				eeprom |= (frame[4] == 0xBB) | (frame[4] == 0xBC);
+				if (next) { next->tx(frame); }
+			}
+			void rx(byte data) { if (next) { next->rx(data); } }
+			void timeout()
+			{
+				timeouts++;
+				if (next) { next->timeout(); }
+			}
+			void discard(byte data) { if (next) { next->discard(data); } }
+		};
+
+		void push(Node *n);
+		Node *pop();
+		void loop();
+		void execute(Node *n);
+		FT817Reading doRead(byte what);
+
+		FT817 radio;
+		Link link;						// I/O thread only
+		FT817Metrics *metrics = NULL;	// I/O thread only
+		std::atomic<Node *> head;	// producers end
+		Node *tail;					// consumer end, I/O thread only
+		Node stub;
+		std::atomic<uint32_t> pending;
+		std::atomic<bool> running;
+		std::atomic<unsigned long> submitted;
+		std::atomic<unsigned long> executed;
+		std::atomic<unsigned long> deduplicated;
+		std::thread io;
+};
+
+template <class F>
+auto FT817Driver::submit(F fn) -> std::future<decltype(fn(std::declval<FT817 &>()))>
+{
+	typedef decltype(fn(std::declval<FT817 &>())) R;
+	auto promise = std::make_shared<std::promise<R>>();
+	std::future<R> result = promise->get_future();
+
+	Node *n = new Node;
+	n->read = 0;
+	n->run = [fn, promise](FT817 &r) mutable { return settle(*promise, fn, r); };
+	push(n);
+	return result;
+}
+
+template <class F, class C>
+void FT817Driver::submit(F fn, C callback)
+{
+	Node *n = new Node;
+	n->read = 0;
+	n->run = [fn, callback](FT817 &r) mutable
+	{
+		callback(fn(r));
+		return true;
+	};
+	push(n);
+}
+
+template <class R, class F>
+bool FT817Driver::settle(std::promise<R> &p, F &fn, FT817 &r)
+{
+	try
+	{
+		if constexpr (std::is_void_v<R>)
+		{
+			fn(r);
+			p.set_value();
+			return true;
+		}
+		else
+		{
+			p.set_value(fn(r));
+			return true;
+		}
+	}
+	catch (...)
+	{
+		p.set_exception(std::current_exception());
+		return false;
+	}
+}
+
+#endif
@@ -0,0 +1,181 @@
+/*
+epoll-demo.cpp the coroutine API driven by an epoll service loop, CPU use
+
+The simulated radio sits on the far end of a pseudo terminal (served by a
+thread of its own, as a real radio would be), the library talks to the
+slave side as to any tty. A few concurrent jobs (S meter polling, keyer and
+narrow toggles) run from an epoll loop that also serves an unrelated
+timer, and the CPU time the loop thread took is reported next to the wall
+time. The same S meter polling is then run with the blocking calls over a
+port that spins waiting for data, for comparison.
+
+	epoll-demo [rounds]
+
+Realtime, it takes a few seconds. Exits with 1 if any result is wrong.
+
+*/
+
+#include <pty.h>
+#include <poll.h>
+#include <stdio.h>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include <sys/timerfd.h>
+#include <time.h>
+#include <unistd.h>
+#include <atomic>
+#include <thread>
+#include "host.h"
+#include "simradio.h"
+#include "serialport.h"
+#include "async.h"
+#include "epoll.h"
+#include "ft817.h"
+
+static unsigned long failures = 0;
+static std::atomic<bool> done(false);
+
+// the radio on the master side of the pty
+static void radioThread(SimRadio *sim, int master)
+{
+	while (!done)
+	{
+		struct pollfd p;
+		p.fd = master;
+		p.events = POLLIN;
+		if (poll(&p, 1, 1) > 0)
+		{
+			byte buf[64];
+			ssize_t n = read(master, buf, sizeof(buf));
+			for (ssize_t i = 0; i < n; i++) { sim->write(buf[i]); }
+		}
+
+		while (sim->available() > 0)
+		{
+			byte b = sim->read();
+			if (write(master, &b, 1) != 1) { break; }
+		}
+	}
+}
+
+static FT817Task<void> meters(FT817Async &rig, byte smeter, int rounds)
+{
+	for (int i = 0; i < rounds * 4; i++)
+	{
+		if ((co_await rig.getSMeter()) != smeter) { failures++; }
+	}
+}
+
+static FT817Task<void> toggler(FT817Async &rig, int rounds, bool before,
+	FT817Task<bool> (FT817Async::*toggle)(), FT817Task<bool> (FT817Async::*get)(bool *))
+{
+	for (int i = 0; i < rounds; i++)
+	{
+		bool now;
+		if (!co_await (rig.*toggle)()) { failures++; }
+		if (!co_await (rig.*get)(&now) || now == before) { failures++; }
+		before = now;
+	}
+}
+
+// wall & this thread CPU time, in ms
+static void times(double *wall, double *cpu)
+{
+	struct timespec t;
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	*wall = t.tv_sec * 1000.0 + t.tv_nsec / 1e6;
+
+	struct rusage ru;
+	getrusage(RUSAGE_THREAD, &ru);
+	*cpu = (ru.ru_utime.tv_sec + ru.ru_stime.tv_sec) * 1000.0 +
+		(ru.ru_utime.tv_usec + ru.ru_stime.tv_usec) / 1000.0;
+}
+
+int main(int argc, char **argv)
+{
+	int rounds = argc > 1 ? atoi(argv[1]) : 3;
+
+	int master, slave;
+	char name[64];
+	if (openpty(&master, &slave, name, NULL, NULL) < 0)
+	{
+		perror("openpty");
+		return 2;
+	}
+
+	SimRadio sim;
+	sim.smeter = 7;
+	bool keyer = bitRead(sim.eeprom[0x58], 4);
+	bool nar = bitRead(sim.eeprom[sim.vfoAddr(sim.vfo()) + 1], 4);
+	std::thread radio(radioThread, &sim, master);
+
+	LinuxSerialPort port;
+	if (!port.open(name))
+	{
+		perror(name);
+		return 2;
+	}
+
+	// the service loop: the radio and an unrelated 100 ms tick
+	FT817Loop loop(port);
+	FT817Async rig(loop);
+	FT817Epoll events(loop, port);
+
+	int service = epoll_create1(0);
+	int tick = timerfd_create(CLOCK_MONOTONIC, 0);
+	struct itimerspec its = {{0, 100000000}, {0, 100000000}};
+	timerfd_settime(tick, 0, &its, NULL);
+
+	struct epoll_event ev;
+	ev.events = EPOLLIN;
+	ev.data.fd = events.fd();
+	epoll_ctl(service, EPOLL_CTL_ADD, events.fd(), &ev);
+	ev.data.fd = tick;
+	epoll_ctl(service, EPOLL_CTL_ADD, tick, &ev);
+
+	double w0, c0, w1, c1;
+	times(&w0, &c0);
+
+	loop.spawn(meters(rig, sim.smeter, rounds));
+	loop.spawn(toggler(rig, rounds, keyer, &FT817Async::toggleKeyer, &FT817Async::getKeyer));
+	loop.spawn(toggler(rig, rounds, nar, &FT817Async::toggleNar, &FT817Async::getNar));
+
+	unsigned long ticks = 0;
+	bool busy = events.process();
+	while (busy)
+	{
+		if (epoll_wait(service, &ev, 1, -1) < 1) { continue; }
+		if (ev.data.fd == tick)
+		{
+			uint64_t n;
+			if (read(tick, &n, sizeof(n)) > 0) { ticks += n; }
+		}
+		else
+		{
+			busy = events.process();
+		}
+	}
+
+	times(&w1, &c1);
+	printf("epoll: %lu frames in %.0f ms, %.1f ms of CPU (%.2f%%), %lu wakeups, %lu ticks served\n",
+		loop.frames, w1 - w0, c1 - c0, 100 * (c1 - c0) / (w1 - w0), events.wakeups, ticks);
+
+	// the blocking calls on a port that spins
+	FT817 blocking;
+	Serial.attach(&port);
+	port.waitMs = 0;
+	blocking.begin(9600);
+	times(&w0, &c0);
+	for (int i = 0; i < rounds * 4; i++)
+	{
+		if (blocking.getSMeter() != sim.smeter) { failures++; }
+	}
+	times(&w1, &c1);
+	printf("spin:  %d frames in %.0f ms, %.1f ms of CPU (%.2f%%)\n",
+		rounds * 4, w1 - w0, c1 - c0, 100 * (c1 - c0) / (w1 - w0));
+
+	done = true;
+	radio.join();
+	printf("%lu failures\n", failures);
+	return failures ? 1 : 0;
+}
@@ -0,0 +1,83 @@
+/*
+epoll.cpp drive a FT817Loop from an epoll based event loop
+
+*/
+
+#include <sys/epoll.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
+#include "epoll.h"
+
+FT817Epoll::FT817Epoll(FT817Loop &loop, LinuxSerialPort &port) : loop(loop), port(port)
+{
+	wakeups = 0;
+
+	// readiness comes from epoll now, the port must not wait on its own
+	port.waitMs = 0;
+
+	ep = epoll_create1(EPOLL_CLOEXEC);
+	timer = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+
+	struct epoll_event ev;
+	ev.events = EPOLLIN;
+	ev.data.fd = port.fd();
+	epoll_ctl(ep, EPOLL_CTL_ADD, port.fd(), &ev);
+	ev.data.fd = timer;
+	epoll_ctl(ep, EPOLL_CTL_ADD, timer, &ev);
+}
+
+FT817Epoll::~FT817Epoll()
+{
+	close(timer);
+	close(ep);
+}
+
+// arm the timer for ms from now, disarm it if ms < 0
+void FT817Epoll::arm(int ms)
+{
+	struct itimerspec its = {};
+	if (ms >= 0)
+	{
+		// 0 would disarm it, fire as soon as possible instead
+		its.it_value.tv_sec = ms / 1000;
+		its.it_value.tv_nsec = (ms % 1000) * 1000000L + 1;
+	}
+	timerfd_settime(timer, 0, &its, NULL);
+}
+
+bool FT817Epoll::process()
+{
+	wakeups++;
+
+	// consume what woke us, the port is read by the loop itself
+	struct epoll_event ev[2];
+	int n = epoll_wait(ep, ev, 2, 0);
+	for (int i = 0; i < n; i++)
+	{
+		if (ev[i].data.fd == timer)
+		{
+			uint64_t expirations;
+			while (read(timer, &expirations, sizeof(expirations)) > 0) { ; }
+		}
+	}
+
+	int ms = 0;
+	bool busy = true;
+	while (busy && ms == 0)
+	{
+		busy = loop.dispatch();
+		ms = loop.timeout();
+	}
+
+	arm(busy ? ms : -1);
+	return busy;
+}
+
+void FT817Epoll::run()
+{
+	struct epoll_event ev;
+	while (process())
+	{
+		epoll_wait(ep, &ev, 1, -1);
+	}
+}
@@ -0,0 +1,59 @@
+/*
+epoll.h drive a FT817Loop from an epoll based event loop
+
+It puts the serial port and a timerfd behind a single epoll fd: add fd()
+to your own epoll set (EPOLLIN) and call process() when it is readable.
+The replies are handled as they come and the timeouts and mandatory delays
+(20 ms between EEPROM reads, 200 ms after a VFO swap, ...) are timerfd
+deadlines, so nothing spins nor sleeps: the CPU use while waiting for the
+radio is near zero.
+
+	LinuxSerialPort port;
+	port.open("/dev/ttyUSB0");
+	FT817Loop loop(port);
+	FT817Async rig(loop);
+	FT817Epoll events(loop, port);
+
+	epoll_ctl(myEpoll, EPOLL_CTL_ADD, events.fd(), &ev);
+	loop.spawn(job(rig));
+	events.process();			// queue the first frames & arm the timer
+	...
+	// in your loop, when events.fd() is readable
+	events.process();
+
+Or, without a loop of your own, events.run() waits on it until all the
+spawned work is done.
+
+It needs the realtime clock of the shim (the default), the virtual one
+only moves on demand.
+
+*/
+
+#ifndef HOST_EPOLL_h
+#define HOST_EPOLL_h
+
+#include "serialport.h"
+#include "async.h"
+
+class FT817Epoll
+{
+	public:
+		FT817Epoll(FT817Loop &loop, LinuxSerialPort &port);
+		~FT817Epoll();
+		int fd() { return ep; }
+		bool process();				// false when the loop has nothing left to do
+		void run();					// process() until there is nothing left to do
+
+		// stats
+		unsigned long wakeups;		// calls to process()
+
+	private:
+		void arm(int ms);
+
+		FT817Loop &loop;
+		LinuxSerialPort &port;
+		int ep;
+		int timer;
+};
+
+#endif
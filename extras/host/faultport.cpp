@@ -0,0 +1,197 @@
+/*
+faultport.cpp a HostPort that injects faults between the library and another port
+
+*/
+
+#include "faultport.h"
+
+FaultPort::FaultPort(HostPort &p, uint64_t s) : inner(p)
+{
+	memset(&config, 0, sizeof(config));
+	memset(&stats, 0, sizeof(stats));
+	config.delayUs = 10000;
+	frameLen = 0;
+	lastByte = 0;
+	readLen = 2;
+	readAddr = 0;
+	seed(s);
+}
+
+void FaultPort::seed(uint64_t s)
+{
+	state = s ? s : 0x9E3779B97F4A7C15ULL;
+}
+
+void FaultPort::level(double p)
+{
+	config.drop = config.corrupt = config.duplicate = p;
+	config.txDrop = config.txCorrupt = config.stale = p;
+	config.delay = 0;
+}
+
+// xorshift64*
+uint64_t FaultPort::random()
+{
+	state ^= state >> 12;
+	state ^= state << 25;
+	state ^= state >> 27;
+	return state * 0x2545F4914F6CDD1DULL;
+}
+
+bool FaultPort::chance(double p)
+{
+	if (p <= 0) { return false; }
+	return (random() >> 11) * (1.0 / 9007199254740992.0) < p;
+}
+
+int FaultPort::available()
+{
+	int count = ready();
+	if (count) { return count; }
+
+	// nothing yet, let the inner port move the (virtual) clock
+	inner.available();
+	return ready();
+}
+
+// pump and count the bytes ready
+int FaultPort::ready()
+{
+	pump();
+	uint64_t now = host::clockUs();
+	int count = 0;
+	for (size_t i = 0; i < rx.size() && rx[i].due <= now; i++)
+	{
+		count++;
+	}
+	return count;
+}
+
+int FaultPort::read()
+{
+	pump();
+	if (rx.empty() || rx.front().due > host::clockUs()) { return -1; }
+	byte data = rx.front().data;
+	rx.pop_front();
+	return data;
+}
+
+int FaultPort::peek()
+{
+	pump();
+	if (rx.empty() || rx.front().due > host::clockUs()) { return -1; }
+	return rx.front().data;
+}
+
+// a byte to the radio
+size_t FaultPort::write(uint8_t data)
+{
+	if (chance(config.txDrop))
+	{
+		stats.txDropped++;
+		return 1;
+	}
+	if (chance(config.txCorrupt))
+	{
+		data ^= 1 << (random() % 8);
+		stats.txCorrupted++;
+	}
+
+	// follow the frames the radio really gets
+	uint64_t now = host::clockUs();
+	if (frameLen && now - lastByte > 20000) { frameLen = 0; }
+	lastByte = now;
+	frame[frameLen++] = data;
+	if (frameLen == 5)
+	{
+		frameLen = 0;
+		unsigned int addr = ((unsigned int)frame[0] << 8) | frame[1];
+		readLen = 2;
+		if (frame[4] == 0xBB)
+		{
+			readAddr = addr;
+			readLen = 0;
+		}
+		if (frame[4] == 0xBC && lastRead.count(addr))
+		{
+			before[addr] = lastRead[addr];
+		}
+	}
+
+	return inner.write(data);
+}
+
+// a byte from the radio, with the byte level faults applied
+void FaultPort::push(byte data, uint64_t due)
+{
+	if (chance(config.drop))
+	{
+		stats.dropped++;
+		return;
+	}
+	if (chance(config.corrupt))
+	{
+		data ^= 1 << (random() % 8);
+		stats.corrupted++;
+	}
+	if (chance(config.delay))
+	{
+		due += random() % (config.delayUs + 1);
+		stats.delayed++;
+	}
+
+	Pending p;
+	p.due = due;
+	p.data = data;
+
+	// keep the line in order, a late byte holds the ones behind it
+	if (!rx.empty() && rx.back().due > p.due) { p.due = rx.back().due; }
+	rx.push_back(p);
+
+	if (chance(config.duplicate))
+	{
+		rx.push_back(p);
+		stats.duplicated++;
+	}
+}
+
+// move all the bytes ready in the inner port to our queue
+void FaultPort::pump()
+{
+	int c;
+	while ((c = inner.read()) >= 0)
+	{
+		uint64_t now = host::clockUs();
+
+		// not an EEPROM read answer
+		if (readLen >= 2)
+		{
+			push(c, now);
+			continue;
+		}
+
+		// hold the EEPROM answer until both bytes are in, it may go stale
+		readData[readLen++] = c;
+		if (readLen < 2) { continue; }
+
+		uint16_t data = ((uint16_t)readData[0] << 8) | readData[1];
+		lastRead[readAddr] = data;
+
+		std::map<unsigned int, uint16_t>::iterator old = before.find(readAddr);
+		if (old != before.end())
+		{
+			if (old->second != data && chance(config.stale))
+			{
+				data = old->second;
+				stats.stale++;
+			}
+			else
+			{
+				before.erase(old);
+			}
+		}
+
+		push(data >> 8, now);
+		push(data & 0xFF, now);
+	}
+}
@@ -0,0 +1,95 @@
+/*
+faultport.h a HostPort that injects faults between the library and another port
+
+Wrap the port of the simulated radio (or any other) with it and every byte
+coming from the radio can be dropped, corrupted (a random bit flipped),
+duplicated or delayed, and the frames going to the radio can have bytes
+dropped or corrupted. It can also answer an EEPROM read with the data the
+address had before the last write (a stale read), as the radio sometimes
+does right after a write.
+
+All the faults are random with the configured probabilities, driven by a
+seeded PRNG, so a run is fully repeatable.
+
+	SimRadio sim;
+	FaultPort faults(sim, 817);
+	faults.config.drop = 0.01;
+	Serial.attach(&faults);
+
+*/
+
+#ifndef HOST_FAULTPORT_h
+#define HOST_FAULTPORT_h
+
+#include <deque>
+#include <map>
+#include "host.h"
+
+struct FaultConfig
+{
+	double drop;		// probability a byte from the radio is lost
+	double corrupt;		// probability a byte from the radio gets a bit flipped
+	double duplicate;	// probability a byte from the radio is received twice
+	double delay;		// probability a byte from the radio is late...
+	uint32_t delayUs;	// ...by up to this time
+	double txDrop;		// probability a byte to the radio is lost
+	double txCorrupt;	// probability a byte to the radio gets a bit flipped
+	double stale;		// probability an EEPROM read gets the data before the last write
+};
+
+struct FaultStats
+{
+	unsigned long dropped;
+	unsigned long corrupted;
+	unsigned long duplicated;
+	unsigned long delayed;
+	unsigned long txDropped;
+	unsigned long txCorrupted;
+	unsigned long stale;
+};
+
+class FaultPort : public HostPort
+{
+	public:
+		FaultPort(HostPort &inner, uint64_t seed = 1);
+		void seed(uint64_t s);
+		void level(double p);		// same probability for all the faults, no delay
+		FaultConfig config;
+		FaultStats stats;
+
+		// HostPort
+		void begin(unsigned long baud) { inner.begin(baud); }
+		int available();
+		int read();
+		int peek();
+		size_t write(uint8_t data);
+
+	private:
+		bool chance(double p);
+		uint64_t random();
+		int ready();				// bytes ready to be read
+		void pump();				// pass the bytes ready in the inner port through the faults
+		void push(byte data, uint64_t due);
+
+		HostPort &inner;
+		uint64_t state;				// PRNG state
+
+		struct Pending
+		{
+			uint64_t due;
+			byte data;
+		};
+		std::deque<Pending> rx;
+
+		// EEPROM tracking for the stale reads
+		byte frame[5];
+		byte frameLen;
+		uint64_t lastByte;			// to drop partial frames as the radio does
+		unsigned int readAddr;		// address of the EEPROM read in progress
+		byte readLen;				// bytes of its answer seen so far
+		byte readData[2];
+		std::map<unsigned int, uint16_t> lastRead;	// last data seen per address
+		std::map<unsigned int, uint16_t> before;	// data before the last write
+};
+
+#endif
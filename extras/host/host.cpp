@@ -0,0 +1,190 @@
+/*
+host.cpp Arduino shim implementation for host builds
+
+*/
+
+#include <time.h>
+#include <stdio.h>
+#include <atomic>
+#include "host.h"
+
+HardwareSerial Serial;
+
+/****** CLOCK ********/
+
+static bool virtualClock = false;
+static uint64_t virtualUs = 0;		// virtual time
+static std::atomic<uint64_t> delayed{0};	// in delay(), us
+static uint64_t realBase = 0;		// monotonic time at the first use
+
+static uint64_t monotonicUs()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000ULL + ts.tv_nsec / 1000;
+}
+
+namespace host
+{
+	void clockRealtime()
+	{
+		virtualClock = false;
+	}
+
+	void clockVirtual(uint32_t start)
+	{
+		virtualClock = true;
+		virtualUs = (uint64_t)start * 1000ULL;
+	}
+
+	bool clockIsVirtual()
+	{
+		return virtualClock;
+	}
+
+	void clockAdvance(uint32_t ms)
+	{
+		if (virtualClock) { virtualUs += (uint64_t)ms * 1000ULL; }
+	}
+
+	void clockAdvanceUs(uint32_t us)
+	{
+		if (virtualClock) { virtualUs += us; }
+	}
+
+	uint64_t delayedUs()
+	{
+		return delayed.load(std::memory_order_relaxed);
+	}
+
+	uint64_t clockUs()
+	{
+		if (virtualClock) { return virtualUs; }
+		if (!realBase) { realBase = monotonicUs(); }
+		return monotonicUs() - realBase;
+	}
+}
+
+unsigned long millis()
+{
+	return (uint32_t)(host::clockUs() / 1000);
+}
+
+unsigned long micros()
+{
+	return (uint32_t)host::clockUs();
+}
+
+void delay(unsigned long ms)
+{
+	delayed.fetch_add((uint64_t)ms * 1000ULL, std::memory_order_relaxed);
+	if (virtualClock)
+	{
+		virtualUs += (uint64_t)ms * 1000ULL;
+		return;
+	}
+
+	struct timespec ts;
+	ts.tv_sec = ms / 1000;
+	ts.tv_nsec = (ms % 1000) * 1000000L;
+	nanosleep(&ts, NULL);
+}
+
+void delayMicroseconds(unsigned int us)
+{
+	delayed.fetch_add(us, std::memory_order_relaxed);
+	if (virtualClock)
+	{
+		virtualUs += us;
+		return;
+	}
+
+	if (!us) { return; }
+
+	struct timespec ts;
+	ts.tv_sec = 0;
+	ts.tv_nsec = us * 1000L;
+	nanosleep(&ts, NULL);
+}
+
+
+/****** PRINT ********/
+
+size_t Print::write(const uint8_t *data, size_t size)
+{
+	size_t n = 0;
+	while (size--)
+	{
+		n += write(*data++);
+	}
+	return n;
+}
+
+size_t Print::print(unsigned long n, int base)
+{
+	char buf[8 * sizeof(long) + 1];
+	char *str = &buf[sizeof(buf) - 1];
+
+	if (base < 2) { base = 10; }
+	*str = '\0';
+	do
+	{
+		char c = n % base;
+		n /= base;
+		*--str = c < 10 ? c + '0' : c + 'A' - 10;
+	} while (n);
+
+	return write(str);
+}
+
+size_t Print::print(long n, int base)
+{
+	if (base == 10 && n < 0)
+	{
+		return print('-') + print((unsigned long)-n, base);
+	}
+	return print((unsigned long)n, base);
+}
+
+
+/****** SERIAL ********/
+
+HardwareSerial::HardwareSerial()
+{
+	hport = NULL;
+}
+
+void HardwareSerial::attach(HostPort *p)
+{
+	hport = p;
+}
+
+void HardwareSerial::begin(unsigned long baud, byte config)
+{
+	if (hport) { hport->begin(baud); }
+}
+
+int HardwareSerial::available()
+{
+	return hport ? hport->available() : 0;
+}
+
+int HardwareSerial::read()
+{
+	return hport ? hport->read() : -1;
+}
+
+int HardwareSerial::peek()
+{
+	return hport ? hport->peek() : -1;
+}
+
+void HardwareSerial::flush()
+{
+	if (hport) { hport->flush(); }
+}
+
+size_t HardwareSerial::write(uint8_t data)
+{
+	return hport ? hport->write(data) : 1;
+}
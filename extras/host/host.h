@@ -0,0 +1,45 @@
+/*
+host.h host side plumbing for the Arduino shim
+
+HostPort
+	The far end of the shim's Serial object, derive from it to feed the
+	library from a trace, a simulated radio, a real tty, etc. Attach it with
+	Serial.attach(&port)
+
+Clock
+	By default millis()/delay() follow the real (monotonic) time, in virtual
+	mode the time only moves when delay() is called or when a port (or your
+	code) advances it, so any timing scenario runs as fast as the CPU allows
+	and it's fully deterministic.
+
+*/
+
+#ifndef HOST_h
+#define HOST_h
+
+#include <Arduino.h>
+
+class HostPort
+{
+	public:
+		virtual ~HostPort() { }
+		virtual void begin(unsigned long baud) { }
+		virtual int available() = 0;
+		virtual int read() = 0;
+		virtual int peek() { return -1; }
+		virtual size_t write(uint8_t data) = 0;
+		virtual void flush() { }
+};
+
+namespace host
+{
+	void clockRealtime();					// millis() follows the monotonic clock (default)
+	void clockVirtual(uint32_t start = 0);	// millis() starts at "start" and only moves on demand
+	bool clockIsVirtual();
+	void clockAdvance(uint32_t ms);			// move the virtual clock forward (no-op in realtime)
+	void clockAdvanceUs(uint32_t us);		// same, in us
+	uint64_t clockUs();						// the full, non wrapping time in us
+	uint64_t delayedUs();					// the time spent in delay() & delayMicroseconds(), in us
+}
+
+#endif
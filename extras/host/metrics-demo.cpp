@@ -0,0 +1,251 @@
+/*
+metrics-demo.cpp a link going bad, as the monitoring sees it
+
+Some threads poll the simulated radio through a FT817Driver with a
+FT817Metrics on it, behind a FaultPort that gets worse on each phase:
+
+	clean		no faults
+	noisy		0.3% of the bytes hit by a fault
+	bad			3%
+
+After each phase it scrapes /metrics over HTTP, as Prometheus would, and
+works out of the counters what an alert rule would: the share of frames
+that timed out and of the operations that failed in the phase, the mean
+reply time and the EEPROM reads that failed their check. Above 1% of
+timeouts or failures it's an ALERT. The retries of the library hide most
+of the noisy link from the user, but not its timeouts: the alert comes
+while nearly every operation still works. Every read submitted must be
+an operation, the deduplicated ones too. Then with the radio mute a
+toggleNar(), a get<>() and a setFreq() submitted as plain calls must show
+as failed, and with it back a call that answers false (a getNar() of a
+NAR off) must not; then it checks /metrics.json.
+
+	metrics-demo [port] [seconds]
+
+The port is 9817 by default (0 takes any free one), with seconds it keeps
+serving the last numbers that long at the end, to look at them with curl.
+
+Exits with 1 if the clean link raises an alert, the noisy or the bad one
+does not, an operation or a failed call is not counted, or a scrape fails.
+
+*/
+
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <string>
+#include <vector>
+#include "host.h"
+#include "simradio.h"
+#include "faultport.h"
+#include "driver.h"
+#include "metrics.h"
+
+#define ALERT_RATIO		0.01
+#define THREADS			4
+#define READS			300		// per thread & phase
+
+struct Phase
+{
+	const char *name;
+	double faults;
+	bool alert;			// expected
+};
+
+static const Phase phases[] = {
+	{"clean", 0, false},
+	{"noisy", 0.003, true},
+	{"bad", 0.03, true}};
+
+// GET a path from the server, the body or "" if it failed
+static std::string get(uint16_t port, const char *path)
+{
+	int fd = socket(AF_INET, SOCK_STREAM, 0);
+	if (fd < 0) { return ""; }
+
+	struct sockaddr_in sa;
+	memset(&sa, 0, sizeof(sa));
+	sa.sin_family = AF_INET;
+	sa.sin_port = htons(port);
+	sa.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+	std::string reply;
+	if (connect(fd, (struct sockaddr *)&sa, sizeof(sa)) == 0)
+	{
+		std::string req = std::string("GET ") + path + " HTTP/1.0\r\n\r\n";
+		if (write(fd, req.data(), req.size()) == (ssize_t)req.size())
+		{
+			char buf[4096];
+			ssize_t n;
+			while ((n = read(fd, buf, sizeof(buf))) > 0) { reply.append(buf, n); }
+		}
+	}
+	close(fd);
+
+	size_t body = reply.find("\r\n\r\n");
+	if ((reply.compare(0, 12, "HTTP/1.0 200") != 0) || (body == std::string::npos)) { return ""; }
+	return reply.substr(body + 4);
+}
+
+// the sum of all the series of a metric, any labels
+static double total(const std::string &text, const char *name)
+{
+	double sum = 0;
+	size_t len = strlen(name);
+	size_t at = 0;
+	while (at < text.size())
+	{
+		size_t end = text.find('\n', at);
+		if (end == std::string::npos) { end = text.size(); }
+		if (!text.compare(at, len, name) && (text[at + len] == ' ' || text[at + len] == '{'))
+		{
+			size_t value = text.rfind(' ', end);
+			sum += strtod(text.c_str() + value + 1, NULL);
+		}
+		at = end + 1;
+	}
+
+	return sum;
+}
+
+struct Counters
+{
+	double frames, timeouts, operations, failures, invalid, replySum, replyCount;
+
+	void scrape(const std::string &text)
+	{
+		frames = total(text, "ft817_frames_total");
+		timeouts = total(text, "ft817_timeouts_total");
+		operations = total(text, "ft817_operations_total");
+		failures = total(text, "ft817_operation_failures_total");
+		invalid = total(text, "ft817_eeprom_invalid_total");
+		replySum = total(text, "ft817_reply_seconds_sum");
+		replyCount = total(text, "ft817_reply_seconds_count");
+	}
+};
+
+static void poller(FT817Driver &rig, int reads)
+{
+	static const FT817Read kinds[] = {
+		FT817_READ_FREQ_MODE, FT817_READ_SMETER, FT817_READ_VFO, FT817_READ_NAR, FT817_READ_TX};
+
+	for (int i = 0; i < reads; i++)
+	{
+		rig.read(kinds[i % (sizeof(kinds) / sizeof(kinds[0]))]).wait();
+	}
+}
+
+int main(int argc, char **argv)
+{
+	uint16_t port = argc > 1 ? atoi(argv[1]) : 9817;
+	int linger = argc > 2 ? atoi(argv[2]) : 0;
+
+	host::clockVirtual();
+	SimRadio sim;
+	FaultPort faults(sim, 817);
+	FT817Metrics metrics;
+	FT817MetricsServer http;
+	if (!http.start(metrics, port))
+	{
+		perror("metrics server");
+		return 2;
+	}
+
+	int failures = 0;
+	{
+		FT817Driver rig(faults);
+		rig.setMetrics(&metrics);
+
+		Counters before;
+		memset(&before, 0, sizeof(before));
+		printf("serving on http://127.0.0.1:%u/metrics\n\n", http.port());
+		printf("%-6s %7s %9s %10s %8s %9s  %s\n", "phase", "frames", "timeouts", "failed ops", "eeprom", "reply ms", "alert");
+
+		for (size_t p = 0; p < sizeof(phases) / sizeof(phases[0]); p++)
+		{
+			// the port belongs to the I/O thread
+			double level = phases[p].faults;
+			rig.submit([&faults, level](FT817 &) { faults.level(level); }).wait();
+
+			std::vector<std::thread> pool;
+			for (int t = 0; t < THREADS; t++) { pool.push_back(std::thread(poller, std::ref(rig), READS)); }
+			for (size_t t = 0; t < pool.size(); t++) { pool[t].join(); }
+
+			std::string text = get(http.port(), "/metrics");
+			if (text.empty())
+			{
+				printf("scrape failed\n");
+				failures++;
+				break;
+			}
+
+			Counters now;
+			now.scrape(text);
+			double frames = now.frames - before.frames;
+			double timeouts = (now.timeouts - before.timeouts) / frames;
+			double failed = (now.failures - before.failures) / (now.operations - before.operations);
+			double reply = (now.replySum - before.replySum) / (now.replyCount - before.replyCount) * 1000;
+			bool alert = (timeouts > ALERT_RATIO) || (failed > ALERT_RATIO);
+
+			printf("%-6s %7.0f %8.2f%% %9.2f%% %8.0f %9.1f  %s\n", phases[p].name, frames, timeouts * 100,
+				failed * 100, now.invalid - before.invalid, reply, alert ? "ALERT" : "-");
+			if (alert != phases[p].alert) { failures++; }
+
+			// the reads & the call that set the level
+			double ops = now.operations - before.operations;
+			if (ops != THREADS * READS + 1)
+			{
+				printf("%.0f operations counted, %d done\n", ops, THREADS * READS + 1);
+				failures++;
+			}
+			before = now;
+		}
+
+		// plain calls that fail, on a mute radio
+		rig.submit([&faults, &sim](FT817 &) { faults.level(0); sim.mute = true; }).wait();
+		rig.submit([](FT817 &r) { return r.toggleNar(); }).wait();
+		rig.submit([](FT817 &r) { return r.get<FT817_FIELD_NAR>(); }).wait();
+		rig.submit([](FT817 &r) { r.setFreq(1407000); }).wait();
+		rig.submit([&sim](FT817 &) { sim.mute = false; }).wait();
+		rig.read(FT817_READ_SMETER).wait();		// the calls before are counted by now
+
+		Counters now;
+		now.scrape(get(http.port(), "/metrics"));
+		double failed = now.failures - before.failures;
+		double invalid = now.invalid - before.invalid;
+		bool counted = (failed == 3) && (invalid == 2);
+		printf("\nmute radio: %.0f failed calls, %.0f EEPROM  %s\n", failed, invalid, counted ? "ok" : "WRONG");
+		if (!counted) { failures++; }
+
+		// a false answer is not a failure
+		before = now;
+		rig.submit([](FT817 &r) { r.get<FT817_FIELD_NAR>() && r.toggleNar(); }).wait();
+		bool nar = rig.submit([](FT817 &r) { return r.getNar(); }).get();
+		rig.read(FT817_READ_SMETER).wait();
+		now.scrape(get(http.port(), "/metrics"));
+		failed = now.failures - before.failures;
+		counted = !nar && (failed == 0);
+		printf("NAR off answered: %.0f failed calls  %s\n", failed, counted ? "ok" : "WRONG");
+		if (!counted) { failures++; }
+
+		std::string json = get(http.port(), "/metrics.json");
+		bool ok = (json.size() > 2) && (json[0] == '{') && (json.find("\"operations\"") != std::string::npos);
+		printf("/metrics.json %zu bytes  %s\n", json.size(), ok ? "ok" : "WRONG");
+		if (!ok) { failures++; }
+
+		rig.setMetrics(NULL);
+	}
+
+	if (linger > 0)
+	{
+		printf("serving for %d s\n", linger);
+		sleep(linger);
+	}
+	http.stop();
+
+	printf("%lu scrapes served\n", http.served.load());
+	return failures ? 1 : 0;
+}
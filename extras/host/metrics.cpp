@@ -0,0 +1,577 @@
+/*
+metrics.cpp link health metrics of the radio for monitoring, on Linux
+
+See metrics.h
+
+*/
+
+#include <errno.h>
+#include <poll.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <algorithm>
+#include "metrics.h"
+#include "driver.h"
+
+static_assert(FT817_READ_KEYER == FT817_METRICS_OPS - 1, "a FT817Read kind without its metrics, see FT817_METRICS_OPS");
+
+const uint32_t ft817MetricsBounds[FT817_METRICS_BUCKETS] = {
+	1000, 2000, 5000, 10000, 20000, 50000, 100000, 200000, 500000, 1000000, 2000000, 5000000};
+
+// per thread, only the owner writes; relaxed atomics just to be read by the
+// snapshots while it does
+struct ShardHistogram
+{
+	std::atomic<uint64_t> bucket[FT817_METRICS_BUCKETS + 1];
+	std::atomic<uint64_t> sum;
+};
+
+struct FT817Metrics::Shard
+{
+	Shard *next = NULL;
+	std::thread::id thread;
+
+	std::atomic<uint64_t> frames[256];
+	std::atomic<uint64_t> timeouts[256];
+	ShardHistogram reply[256];
+	std::atomic<uint64_t> rxBytes;
+	std::atomic<uint64_t> discarded;
+	std::atomic<uint64_t> lastRx;		// clockUs() + 1 of the last byte, 0 if none
+
+	std::atomic<uint64_t> calls[FT817_METRICS_OPS];
+	std::atomic<uint64_t> failures[FT817_METRICS_OPS];
+	ShardHistogram took[FT817_METRICS_OPS];
+	std::atomic<uint64_t> eepromInvalid;
+
+	// the frame whose answer is coming
+	byte cmd = 0;
+	byte expected = 0;
+	byte got = 0;
+	bool open = false;			// answer not complete yet
+	bool missed = true;			// its timeout is counted already
+	uint64_t sent = 0;
+};
+
+// the only writer, so no read-modify-write is needed
+static inline void bump(std::atomic<uint64_t> &a, uint64_t n = 1)
+{
+	a.store(a.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+}
+
+/****** LABELS ********/
+
+const char *ft817MetricsCmd(byte cmd)
+{
+	switch (cmd)
+	{
+		case CAT_LOCK_ON:			return "lock_on";
+		case CAT_LOCK_OFF:			return "lock_off";
+		case CAT_PTT_ON:			return "ptt_on";
+		case CAT_PTT_OFF:			return "ptt_off";
+		case CAT_FREQ_SET:			return "freq_set";
+		case CAT_MODE_SET:			return "mode_set";
+		case CAT_CLAR_ON:			return "clar_on";
+		case CAT_CLAR_OFF:			return "clar_off";
+		case CAT_CLAR_SET:			return "clar_set";
+		case CAT_VFO_AB:			return "vfo_ab";
+		case CAT_SPLIT_ON:			return "split_on";
+		case CAT_SPLIT_OFF:			return "split_off";
+		case CAT_RPTR_OFFSET_CMD:	return "rptr_offset";
+		case CAT_RPTR_FREQ_SET:		return "rptr_freq";
+		case CAT_SQL_CMD:			return "sql";
+		case CAT_SQL_CTCSS_SET:		return "ctcss_set";
+		case CAT_SQL_DCS_SET:		return "dcs_set";
+		case CAT_RX_DATA_CMD:		return "rx_status";
+		case CAT_TX_DATA_CMD:		return "tx_status";
+		case CAT_RX_FREQ_CMD:		return "freq_mode";
+		case 0xBB:					return "eeprom_read";
+		case 0xBC:					return "eeprom_write";
+	}
+
+	// "0x8f"..., made once
+	struct Hex
+	{
+		char label[256][5];
+		Hex() { for (unsigned c = 0; c < 256; c++) { snprintf(label[c], 5, "0x%02x", c); } }
+	};
+	static const Hex others;
+	return others.label[cmd];
+}
+
+const char *ft817MetricsOp(byte op)
+{
+	static const char *const names[FT817_METRICS_OPS] = {
+		"call", "freq_mode", "smeter", "pmeter", "tx", "vfo", "band_a", "band_b",
+		"display", "nar", "ipo", "breakin", "keyer"};
+
+	return op < FT817_METRICS_OPS ? names[op] : "unknown";
+}
+
+/****** RECORDING ********/
+
+static std::atomic<uint64_t> serials(0);
+
+FT817Metrics::FT817Metrics(FT817Tap *next)
+	: next(next), serial(serials.fetch_add(1) + 1), shards(NULL), queued(0)
+{
+}
+
+FT817Metrics::~FT817Metrics()
+{
+	Shard *s = shards.load();
+	while (s)
+	{
+		Shard *n = s->next;
+		delete s;
+		s = n;
+	}
+}
+
+FT817Metrics::Shard *FT817Metrics::shard()
+{
+	// the last one used by this thread, the usual case
+	static thread_local uint64_t cachedSerial = 0;
+	static thread_local Shard *cached = NULL;
+	if (cachedSerial == serial) { return cached; }
+
+	std::thread::id me = std::this_thread::get_id();
+	Shard *s = shards.load(std::memory_order_acquire);
+	while (s && (s->thread != me)) { s = s->next; }
+
+	if (!s)
+	{
+		s = new Shard();
+		s->thread = me;
+		s->next = shards.load(std::memory_order_relaxed);
+		while (!shards.compare_exchange_weak(s->next, s, std::memory_order_release, std::memory_order_relaxed)) { }
+	}
+
+	cachedSerial = serial;
+	cached = s;
+	return s;
+}
+
+static void observe(ShardHistogram &h, uint64_t us)
+{
+	byte i = 0;
+	while ((i < FT817_METRICS_BUCKETS) && (us > ft817MetricsBounds[i])) { i++; }
+	bump(h.bucket[i]);
+	bump(h.sum, us);
+}
+
+void FT817Metrics::tx(const byte *frame)
+{
+	Shard *s = shard();
+	s->cmd = frame[4];
+	s->expected = ft817ReplySize(frame[4]);
+	s->got = 0;
+	s->open = true;
+	s->missed = false;
+	s->sent = host::clockUs();
+	bump(s->frames[s->cmd]);
+
+	if (next) { next->tx(frame); }
+}
+
+void FT817Metrics::rx(byte data)
+{
+	Shard *s = shard();
+	uint64_t now = host::clockUs();
+	bump(s->rxBytes);
+	s->lastRx.store(now + 1, std::memory_order_relaxed);
+
+	// the answers some calls don't read are not timed, the next frame just
+	// takes over
+	if (s->open && (++s->got >= s->expected))
+	{
+		s->open = false;
+		if (!s->missed) { observe(s->reply[s->cmd], now - s->sent); }
+	}
+
+	if (next) { next->rx(data); }
+}
+
+void FT817Metrics::timeout()
+{
+	// once per frame, a frame with all the answer missing is one timeout
+	Shard *s = shard();
+	if (!s->missed)
+	{
+		bump(s->timeouts[s->cmd]);
+		s->missed = true;
+	}
+	if (s->open && (++s->got >= s->expected)) { s->open = false; }
+
+	if (next) { next->timeout(); }
+}
+
+void FT817Metrics::discard(byte data)
+{
+	bump(shard()->discarded);
+
+	if (next) { next->discard(data); }
+}
+
+void FT817Metrics::operation(byte op, uint64_t us, bool ok, bool eeprom)
+{
+	if (op >= FT817_METRICS_OPS) { return; }
+
+	Shard *s = shard();
+	bump(s->calls[op]);
+	observe(s->took[op], us);
+	if (!ok)
+	{
+		bump(s->failures[op]);
+		if (eeprom) { bump(s->eepromInvalid); }
+	}
+}
+
+/****** SNAPSHOT ********/
+
+static void add(FT817Histogram &to, const ShardHistogram &h)
+{
+	for (byte b = 0; b <= FT817_METRICS_BUCKETS; b++)
+	{
+		uint64_t n = h.bucket[b].load(std::memory_order_relaxed);
+		to.bucket[b] += n;
+		to.count += n;
+	}
+	to.sum += h.sum.load(std::memory_order_relaxed);
+}
+
+void FT817Metrics::snapshot(FT817MetricsSnapshot *out)
+{
+	memset(out, 0, sizeof(*out));
+	uint64_t last = 0;
+
+	for (Shard *s = shards.load(std::memory_order_acquire); s; s = s->next)
+	{
+		for (unsigned c = 0; c < 256; c++)
+		{
+			out->frames[c] += s->frames[c].load(std::memory_order_relaxed);
+			out->timeouts[c] += s->timeouts[c].load(std::memory_order_relaxed);
+			add(out->reply[c], s->reply[c]);
+		}
+		out->rxBytes += s->rxBytes.load(std::memory_order_relaxed);
+		out->discarded += s->discarded.load(std::memory_order_relaxed);
+		last = std::max(last, s->lastRx.load(std::memory_order_relaxed));
+
+		for (byte o = 0; o < FT817_METRICS_OPS; o++)
+		{
+			out->calls[o] += s->calls[o].load(std::memory_order_relaxed);
+			out->failures[o] += s->failures[o].load(std::memory_order_relaxed);
+			add(out->took[o], s->took[o]);
+		}
+		out->eepromInvalid += s->eepromInvalid.load(std::memory_order_relaxed);
+		out->threads++;
+	}
+
+	out->queued = queued.load(std::memory_order_relaxed);
+	out->lastReplyAge = -1;
+	if (last)
+	{
+		uint64_t now = host::clockUs();
+		out->lastReplyAge = now + 1 > last ? now + 1 - last : 0;
+	}
+}
+
+uint64_t FT817MetricsSnapshot::totalFrames() const
+{
+	uint64_t n = 0;
+	for (unsigned c = 0; c < 256; c++) { n += frames[c]; }
+	return n;
+}
+
+uint64_t FT817MetricsSnapshot::totalTimeouts() const
+{
+	uint64_t n = 0;
+	for (unsigned c = 0; c < 256; c++) { n += timeouts[c]; }
+	return n;
+}
+
+/****** EXPORT ********/
+
+static void append(std::string &out, const char *fmt, ...)
+{
+	char line[256];
+	va_list args;
+	va_start(args, fmt);
+	int n = vsnprintf(line, sizeof(line), fmt, args);
+	va_end(args);
+	if (n > 0) { out.append(line, std::min((size_t)n, sizeof(line) - 1)); }
+}
+
+static void family(std::string &out, const char *name, const char *type, const char *help)
+{
+	append(out, "# HELP %s %s\n# TYPE %s %s\n", name, help, name, type);
+}
+
+static void histogram(std::string &out, const char *name, const char *label, const char *value, const FT817Histogram &h)
+{
+	uint64_t n = 0;
+	for (byte b = 0; b < FT817_METRICS_BUCKETS; b++)
+	{
+		n += h.bucket[b];
+		append(out, "%s_bucket{%s=\"%s\",le=\"%g\"} %llu\n", name, label, value,
+			ft817MetricsBounds[b] / 1e6, (unsigned long long)n);
+	}
+	append(out, "%s_bucket{%s=\"%s\",le=\"+Inf\"} %llu\n", name, label, value, (unsigned long long)h.count);
+	append(out, "%s_sum{%s=\"%s\"} %.6f\n", name, label, value, h.sum / 1e6);
+	append(out, "%s_count{%s=\"%s\"} %llu\n", name, label, value, (unsigned long long)h.count);
+}
+
+std::string FT817Metrics::prometheus()
+{
+	FT817MetricsSnapshot *s = new FT817MetricsSnapshot;
+	snapshot(s);
+	std::string out;
+
+	// per command, only the ones sent
+	family(out, "ft817_frames_total", "counter", "CAT frames sent to the radio.");
+	for (unsigned c = 0; c < 256; c++)
+	{
+		if (s->frames[c]) { append(out, "ft817_frames_total{cmd=\"%s\"} %llu\n", ft817MetricsCmd(c), (unsigned long long)s->frames[c]); }
+	}
+
+	family(out, "ft817_timeouts_total", "counter", "CAT frames with part or all of the answer missing.");
+	for (unsigned c = 0; c < 256; c++)
+	{
+		if (s->frames[c]) { append(out, "ft817_timeouts_total{cmd=\"%s\"} %llu\n", ft817MetricsCmd(c), (unsigned long long)s->timeouts[c]); }
+	}
+
+	family(out, "ft817_reply_seconds", "histogram", "Time from a frame sent to the last byte of its answer.");
+	for (unsigned c = 0; c < 256; c++)
+	{
+		if (s->reply[c].count) { histogram(out, "ft817_reply_seconds", "cmd", ft817MetricsCmd(c), s->reply[c]); }
+	}
+
+	family(out, "ft817_rx_bytes_total", "counter", "Bytes received from the radio.");
+	append(out, "ft817_rx_bytes_total %llu\n", (unsigned long long)s->rxBytes);
+
+	family(out, "ft817_discarded_bytes_total", "counter", "Stale or late bytes thrown away before a frame.");
+	append(out, "ft817_discarded_bytes_total %llu\n", (unsigned long long)s->discarded);
+
+	// per operation
+	family(out, "ft817_operations_total", "counter", "Calls and reads run against the radio.");
+	for (byte o = 0; o < FT817_METRICS_OPS; o++)
+	{
+		if (s->calls[o]) { append(out, "ft817_operations_total{op=\"%s\"} %llu\n", ft817MetricsOp(o), (unsigned long long)s->calls[o]); }
+	}
+
+	family(out, "ft817_operation_failures_total", "counter", "Calls and reads that failed.");
+	for (byte o = 0; o < FT817_METRICS_OPS; o++)
+	{
+		if (s->calls[o]) { append(out, "ft817_operation_failures_total{op=\"%s\"} %llu\n", ft817MetricsOp(o), (unsigned long long)s->failures[o]); }
+	}
+
+	family(out, "ft817_operation_seconds", "histogram", "Time a call or read took.");
+	for (byte o = 0; o < FT817_METRICS_OPS; o++)
+	{
+		if (s->calls[o]) { histogram(out, "ft817_operation_seconds", "op", ft817MetricsOp(o), s->took[o]); }
+	}
+
+	family(out, "ft817_eeprom_invalid_total", "counter", "EEPROM based reads that failed their check (eepromValidData).");
+	append(out, "ft817_eeprom_invalid_total %llu\n", (unsigned long long)s->eepromInvalid);
+
+	family(out, "ft817_queue_waiting", "gauge", "Calls waiting in the driver queue.");
+	append(out, "ft817_queue_waiting %u\n", s->queued);
+
+	if (s->lastReplyAge >= 0)
+	{
+		family(out, "ft817_last_reply_age_seconds", "gauge", "Time since the last byte from the radio.");
+		append(out, "ft817_last_reply_age_seconds %.3f\n", s->lastReplyAge / 1e6);
+	}
+
+	delete s;
+	return out;
+}
+
+static void histogramJSON(std::string &out, const FT817Histogram &h)
+{
+	append(out, "{\"count\": %llu, \"sum\": %.6f, \"buckets\": {", (unsigned long long)h.count, h.sum / 1e6);
+	uint64_t n = 0;
+	for (byte b = 0; b < FT817_METRICS_BUCKETS; b++)
+	{
+		n += h.bucket[b];
+		append(out, "\"%g\": %llu, ", ft817MetricsBounds[b] / 1e6, (unsigned long long)n);
+	}
+	append(out, "\"+Inf\": %llu}}", (unsigned long long)h.count);
+}
+
+std::string FT817Metrics::json()
+{
+	FT817MetricsSnapshot *s = new FT817MetricsSnapshot;
+	snapshot(s);
+	std::string out;
+
+	append(out, "{\n\t\"threads\": %u,\n\t\"rx_bytes\": %llu,\n\t\"discarded_bytes\": %llu,\n\t\"eeprom_invalid\": %llu,\n\t\"queue_waiting\": %u,\n",
+		s->threads, (unsigned long long)s->rxBytes, (unsigned long long)s->discarded, (unsigned long long)s->eepromInvalid, s->queued);
+	if (s->lastReplyAge >= 0) { append(out, "\t\"last_reply_age\": %.3f,\n", s->lastReplyAge / 1e6); }
+	else { out += "\t\"last_reply_age\": null,\n"; }
+
+	out += "\t\"frames\": {";
+	const char *sep = "\n";
+	for (unsigned c = 0; c < 256; c++)
+	{
+		if (!s->frames[c]) { continue; }
+		append(out, "%s\t\t\"%s\": {\"sent\": %llu, \"timeouts\": %llu, \"reply\": ", sep, ft817MetricsCmd(c),
+			(unsigned long long)s->frames[c], (unsigned long long)s->timeouts[c]);
+		histogramJSON(out, s->reply[c]);
+		out += "}";
+		sep = ",\n";
+	}
+	out += "\n\t},\n\t\"operations\": {";
+
+	sep = "\n";
+	for (byte o = 0; o < FT817_METRICS_OPS; o++)
+	{
+		if (!s->calls[o]) { continue; }
+		append(out, "%s\t\t\"%s\": {\"calls\": %llu, \"failures\": %llu, \"took\": ", sep, ft817MetricsOp(o),
+			(unsigned long long)s->calls[o], (unsigned long long)s->failures[o]);
+		histogramJSON(out, s->took[o]);
+		out += "}";
+		sep = ",\n";
+	}
+	out += "\n\t}\n}\n";
+
+	delete s;
+	return out;
+}
+
+/****** HTTP ********/
+
+bool FT817MetricsServer::start(FT817Metrics &m, uint16_t port, const char *address)
+{
+	stop();
+	metrics = &m;
+
+	struct sockaddr_in sa;
+	memset(&sa, 0, sizeof(sa));
+	sa.sin_family = AF_INET;
+	sa.sin_port = htons(port);
+	if (inet_pton(AF_INET, address, &sa.sin_addr) != 1)
+	{
+		errno = EINVAL;
+		return false;
+	}
+
+	listener = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+	if (listener < 0) { return false; }
+
+	int on = 1;
+	setsockopt(listener, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+	socklen_t len = sizeof(sa);
+	if (bind(listener, (struct sockaddr *)&sa, sizeof(sa)) < 0 || listen(listener, 8) < 0 ||
+		getsockname(listener, (struct sockaddr *)&sa, &len) < 0)
+	{
+		int e = errno;
+		close(listener);
+		listener = -1;
+		errno = e;
+		return false;
+	}
+
+	bound = ntohs(sa.sin_port);
+	running.store(true);
+	thread = std::thread(&FT817MetricsServer::loop, this);
+	return true;
+}
+
+void FT817MetricsServer::stop()
+{
+	if (!running.exchange(false)) { return; }
+	thread.join();
+	close(listener);
+	listener = -1;
+}
+
+void FT817MetricsServer::loop()
+{
+	while (running.load())
+	{
+		// wake up now and then to see if it's stopped
+		struct pollfd p = {listener, POLLIN, 0};
+		if (poll(&p, 1, 100) <= 0) { continue; }
+
+		int fd = accept4(listener, NULL, NULL, SOCK_CLOEXEC);
+		if (fd < 0) { continue; }
+		answer(fd);
+		close(fd);
+	}
+}
+
+static void sendAll(int fd, const std::string &data)
+{
+	size_t done = 0;
+	while (done < data.size())
+	{
+		ssize_t n = send(fd, data.data() + done, data.size() - done, MSG_NOSIGNAL);
+		if (n < 0 && errno == EINTR) { continue; }
+		if (n <= 0) { return; }
+		done += n;
+	}
+}
+
+void FT817MetricsServer::answer(int fd)
+{
+	// a slow or silent client can't hold the server for long
+	struct timeval tv = {1, 0};
+	setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+
+	// the request line is all it needs
+	char req[1024];
+	size_t got = 0;
+	while (got < sizeof(req) - 1)
+	{
+		ssize_t n = recv(fd, req + got, sizeof(req) - 1 - got, 0);
+		if (n < 0 && errno == EINTR) { continue; }
+		if (n <= 0) { break; }
+		got += n;
+		req[got] = 0;
+		if (strstr(req, "\r\n\r\n") || strstr(req, "\n\n")) { break; }
+	}
+	req[got] = 0;
+
+	char method[8] = "";
+	char path[256] = "";
+	sscanf(req, "%7s %255s", method, path);
+	char *query = strchr(path, '?');
+	if (query) { *query = 0; }
+
+	const char *status = "200 OK";
+	const char *type = "text/plain; version=0.0.4; charset=utf-8";
+	std::string body;
+	if (strcmp(method, "GET"))
+	{
+		status = "405 Method Not Allowed";
+		type = "text/plain";
+		body = "GET only\n";
+	}
+	else if (!strcmp(path, "/metrics"))
+	{
+		body = metrics->prometheus();
+	}
+	else if (!strcmp(path, "/metrics.json"))
+	{
+		type = "application/json";
+		body = metrics->json();
+	}
+	else
+	{
+		status = "404 Not Found";
+		type = "text/plain";
+		body = "try /metrics or /metrics.json\n";
+	}
+
+	std::string head;
+	append(head, "HTTP/1.0 %s\r\nContent-Type: %s\r\nContent-Length: %zu\r\nConnection: close\r\n\r\n",
+		status, type, body.size());
+	sendAll(fd, head);
+	sendAll(fd, body);
+	served.fetch_add(1, std::memory_order_relaxed);
+}
@@ -0,0 +1,143 @@
+/*
+metrics.h link health metrics of the radio for monitoring, on Linux
+
+FT817Metrics is a traffic tap (see src/ft817trace.h) that counts every CAT
+frame and the time its answer took, per command, and the frames whose
+answer did not come (timeouts). Given to a FT817Driver it also times every
+call & read it runs (the deduplicated ones too) and counts the ones that
+failed, the ones with a bad eepromValidData among them (see driver.h for
+when a call fails):
+
+	FT817Metrics metrics;
+	FT817Driver rig(port);
+	rig.setMetrics(&metrics);
+
+	FT817MetricsServer http;
+	http.start(metrics, 9817);		// http://127.0.0.1:9817/metrics
+
+Without the driver set it as the tap of your FT817 object, and call
+operation() if you want the calls too.
+
+The counters are per thread: each thread that records has a block of its
+own that only it writes (plain relaxed loads & stores, no locked
+instructions), the blocks are summed when a snapshot is taken. So
+recording a frame costs a few ns and never waits on a scrape, and a scrape
+never stops the radio.
+
+The latencies go to histograms with fixed buckets (1 ms to 5 s, see
+FT817_METRICS_BUCKETS), in the Prometheus text format on /metrics and as
+a JSON snapshot on /metrics.json (or json() at any time). To alert on a
+degrading link before the operator notices, the rates of
+ft817_timeouts_total and ft817_operation_failures_total against
+ft817_frames_total, the reply time quantiles and ft817_last_reply_age_seconds
+(a mute radio) are the ones to watch; see metrics-demo.cpp.
+
+It takes the place of any other tap of the radio: give that one to the
+constructor and it gets the same calls (ie. a FT817Trace recording).
+
+*/
+
+#ifndef HOST_METRICS_h
+#define HOST_METRICS_h
+
+#include <atomic>
+#include <string>
+#include <thread>
+#include "host.h"
+#include "ft817.h"
+
+#define FT817_METRICS_BUCKETS	12		// finite buckets of a histogram, +Inf is one more
+#define FT817_METRICS_OPS		13		// a plain call (0) & every FT817Read kind
+
+// bucket upper bounds, us
+extern const uint32_t ft817MetricsBounds[FT817_METRICS_BUCKETS];
+
+struct FT817Histogram
+{
+	uint64_t bucket[FT817_METRICS_BUCKETS + 1];	// per bucket, not cumulative; last is +Inf
+	uint64_t count;
+	uint64_t sum;								// us
+};
+
+// all the threads summed, plain numbers
+struct FT817MetricsSnapshot
+{
+	uint64_t frames[256];			// per command (the last byte of the frame)
+	uint64_t timeouts[256];			// frames with part of the answer missing
+	FT817Histogram reply[256];		// frame sent to the last byte of its answer
+	uint64_t rxBytes;
+	uint64_t discarded;				// stale bytes thrown away before a frame
+
+	uint64_t calls[FT817_METRICS_OPS];		// per operation, see operation()
+	uint64_t failures[FT817_METRICS_OPS];
+	FT817Histogram took[FT817_METRICS_OPS];
+	uint64_t eepromInvalid;			// failed EEPROM based reads (eepromValidData)
+
+	uint32_t queued;				// calls waiting in the driver, last seen
+	int64_t lastReplyAge;			// us since the last byte of the radio, -1 if none yet
+	unsigned threads;				// that recorded something
+	uint64_t totalFrames() const;
+	uint64_t totalTimeouts() const;
+};
+
+const char *ft817MetricsCmd(byte cmd);		// label of a command, "freq_mode", "0x8f", ...
+const char *ft817MetricsOp(byte op);		// label of an operation, "call", "smeter", ...
+
+class FT817Metrics : public FT817Tap
+{
+	public:
+		FT817Metrics(FT817Tap *next = NULL);
+		~FT817Metrics();
+
+		// tap, on the thread that talks to the radio
+		void tx(const byte *frame);
+		void rx(byte data);
+		void timeout();
+		void discard(byte data);
+
+		// a call (op 0) or a read (op = FT817Read) that took "us", false if it
+		// failed; "eeprom" if it's an EEPROM based one, so a failure is a bad
+		// eepromValidData
+		void operation(byte op, uint64_t us, bool ok, bool eeprom = false);
+		void queue(uint32_t waiting) { queued.store(waiting, std::memory_order_relaxed); }
+
+		// any thread
+		void snapshot(FT817MetricsSnapshot *s);
+		std::string prometheus();
+		std::string json();
+
+	private:
+		struct Shard;
+		Shard *shard();				// the one of this thread, made on its first use
+
+		FT817Tap *next;
+		uint64_t serial;			// tells this object from a later one at the same address
+		std::atomic<Shard *> shards;
+		std::atomic<uint32_t> queued;
+};
+
+// a minimal HTTP server for the scrapes: GET /metrics and /metrics.json,
+// one request per connection, on its own thread
+class FT817MetricsServer
+{
+	public:
+		~FT817MetricsServer() { stop(); }
+		bool start(FT817Metrics &metrics, uint16_t port = 9817, const char *address = "127.0.0.1");
+		void stop();
+		uint16_t port() { return bound; }	// the real one if started on port 0
+
+		// stats
+		std::atomic<unsigned long> served{0};
+
+	private:
+		void loop();
+		void answer(int fd);
+
+		FT817Metrics *metrics = NULL;
+		int listener = -1;
+		uint16_t bound = 0;
+		std::atomic<bool> running{false};
+		std::thread thread;
+};
+
+#endif
@@ -0,0 +1,145 @@
+/*
+poll-demo.cpp fixed rate polling vs FT817Poller over a session
+
+Two minutes of a simulated session on the virtual clock:
+
+	  0 -  30 s	idle
+	 30 -  40 s	tuning, a 10 Hz step every 50 ms
+	 40 -  60 s	idle
+	 60 -  65 s	TX
+	 65 -  90 s	a fading signal, the S-meter moves every 200 ms
+	 90 - 120 s	idle
+
+polled with every field at a fixed 100 ms and with the default adaptive
+rates. Reports the frames per second while idle and while active, the
+frequency steps seen, the lag from each to the poller seeing it and the
+time to see the first one after the idle period.
+
+	poll-demo
+
+Exits with 1 if the poller does not end with the right values, sees fewer
+steps than fixed polling, the first one or the worst one more than
+LAG_SLACK ms later, or does not poll less than half as often while idle.
+
+*/
+
+#include <limits.h>
+#include <stdio.h>
+#include "host.h"
+#include "simradio.h"
+#include "ft817.h"
+#include "ft817poll.h"
+
+#define LAG_SLACK	25		// ms, two polls on the wire
+
+static const unsigned long base = 1407000;
+static SimRadio sim;
+
+struct Result
+{
+	double idle;			// frames per second
+	unsigned long seen;		// steps
+	unsigned long lagMax;
+	unsigned long first;
+	bool ok;				// ends with the right values
+};
+
+static bool active(uint32_t t)
+{
+	return (t >= 30000 && t < 40000) || (t >= 60000 && t < 90000);
+}
+
+// the radio at a time
+static void session(uint32_t t)
+{
+	if (t < 30000) { sim.freq[sim.vfo()] = base; }
+	else if (t < 40000) { sim.freq[sim.vfo()] = base + (t - 30000) / 50; }
+	sim.ptt = t >= 60000 && t < 65000;
+	sim.pmeter = sim.ptt ? 10 : 0;
+	sim.smeter = t >= 65000 && t < 90000 ? ((t - 65000) / 200) * 7 % 16 : 3;
+}
+
+static Result run(const char *title, bool fixed)
+{
+	host::clockVirtual();
+	sim.reset();
+
+	FT817 radio;
+	radio.begin(9600);
+	FT817Poller poller;
+	poller.begin(radio);
+	if (fixed)
+	{
+		for (byte i = 0; i < FT817_POLL_FIELDS; i++) { poller.setRange(i, 100, 100); }
+	}
+
+	unsigned long framesIdle = 0, framesActive = 0;
+	unsigned long lagTotal = 0, lagMax = 0, seen = 0, first = 0;
+	unsigned long last = sim.frames;
+	while (millis() < 120000)
+	{
+		uint32_t t = millis();
+		session(t);
+
+		byte changed = poller.update();
+		if ((changed & FT817_POLL_BIT(FT817_POLL_FREQ)) && poller.freq > base)
+		{
+			unsigned long lag = millis() - (30000 + (poller.freq - base) * 50);
+			if (!seen) { first = millis() - 30000; }
+			lagTotal += lag;
+			if (lag > lagMax) { lagMax = lag; }
+			seen++;
+		}
+
+		if (active(t)) { framesActive += sim.frames - last; } else { framesIdle += sim.frames - last; }
+		last = sim.frames;
+
+		if (millis() == t) { host::clockAdvance(1); }
+	}
+
+	printf("%-10s %8lu %9.2f %9.2f %7lu %9.1f %9lu %9lu\n", title, poller.polls,
+		framesIdle / 80.0, framesActive / 40.0, seen, seen ? lagTotal / (double)seen : 0, lagMax, first);
+
+	Result r;
+	r.idle = framesIdle / 80.0;
+	r.seen = seen;
+	r.lagMax = lagMax;
+	r.first = seen ? first : ULONG_MAX;
+	r.ok = poller.freq == sim.freq[sim.vfo()] && poller.smeter == sim.smeter && !poller.tx;
+	return r;
+}
+
+int main()
+{
+	Serial.attach(&sim);
+
+	printf("%-10s %8s %9s %9s %7s %9s %9s %9s\n", "", "polls", "idle f/s", "busy f/s", "steps", "avg lag", "max lag", "first ms");
+	Result fixed = run("fixed", true);
+	Result adaptive = run("adaptive", false);
+
+	int failures = 0;
+	if (!fixed.ok || !adaptive.ok) { failures++; }
+	if (adaptive.seen < fixed.seen)
+	{
+		printf("adaptive sees %lu steps, fixed %lu\n", adaptive.seen, fixed.seen);
+		failures++;
+	}
+	if (adaptive.first > fixed.first + LAG_SLACK)
+	{
+		printf("adaptive sees the first step %lu ms after fixed\n", adaptive.first - fixed.first);
+		failures++;
+	}
+	if (adaptive.lagMax > fixed.lagMax + LAG_SLACK)
+	{
+		printf("adaptive max lag %lu ms over fixed\n", adaptive.lagMax - fixed.lagMax);
+		failures++;
+	}
+	if (adaptive.idle * 2 > fixed.idle)
+	{
+		printf("adaptive polls %.2f f/s while idle, fixed %.2f\n", adaptive.idle, fixed.idle);
+		failures++;
+	}
+
+	printf("%s\n", failures ? "FAILED" : "ok");
+	return failures ? 1 : 0;
+}
@@ -0,0 +1,112 @@
+/*
+replay.cpp a HostPort that plays back a recorded ft817 trace
+
+*/
+
+#include "replay.h"
+
+ReplayPort::ReplayPort(const std::vector<TraceRecord> &trace, unsigned int t) : recs(trace)
+{
+	pos = 0;
+	timing = t;
+	frameLen = 0;
+	txFrames = 0;
+	txDiverged = 0;
+}
+
+void ReplayPort::setTiming(unsigned int percent)
+{
+	timing = percent;
+}
+
+// bytes ready to be read, in virtual clock mode the clock is moved up to
+// the next recorded byte, or just a ms if there is none (so the library
+// timeouts do expire)
+int ReplayPort::available()
+{
+	uint64_t now = host::clockUs();
+	int count = 0;
+	for (size_t i = 0; i < rx.size() && rx[i].due <= now; i++)
+	{
+		count++;
+	}
+
+	if (count || !host::clockIsVirtual()) { return count; }
+
+	if (rx.empty())
+	{
+		host::clockAdvance(1);
+		return 0;
+	}
+
+	host::clockAdvanceUs(rx.front().due - now);
+	return available();
+}
+
+int ReplayPort::read()
+{
+	if (rx.empty() || rx.front().due > host::clockUs()) { return -1; }
+	byte data = rx.front().data;
+	rx.pop_front();
+	return data;
+}
+
+int ReplayPort::peek()
+{
+	if (rx.empty() || rx.front().due > host::clockUs()) { return -1; }
+	return rx.front().data;
+}
+
+// collect the frame sent by the library and check it against the trace
+size_t ReplayPort::write(uint8_t data)
+{
+	frame[frameLen++] = data;
+	if (frameLen < 5) { return 1; }
+	frameLen = 0;
+	txFrames++;
+
+	// bytes the library did not read are lost, as in the wire
+	rx.clear();
+
+	// next TX in the trace
+	while (pos < recs.size() && recs[pos].type != FT817_TRACE_TX)
+	{
+		pos++;
+	}
+
+	if (pos >= recs.size() || memcmp(recs[pos].data, frame, 5) != 0)
+	{
+		txDiverged++;
+	}
+
+	if (pos < recs.size())
+	{
+		pos++;
+		schedule();
+	}
+
+	return 1;
+}
+
+// queue all the RX bytes up to the next TX, at the scaled recorded times;
+// the discarded ones too, the library throws them away again
+void ReplayPort::schedule()
+{
+	uint64_t due = host::clockUs();
+	for (; pos < recs.size() && recs[pos].type != FT817_TRACE_TX; pos++)
+	{
+		due += (uint64_t)recs[pos].delta * timing * 10;	// ms * % -> us
+		if (recs[pos].type == FT817_TRACE_RX || recs[pos].type == FT817_TRACE_DISCARD)
+		{
+			Pending p;
+			p.due = due;
+			p.data = recs[pos].data[0];
+			rx.push_back(p);
+		}
+	}
+}
+
+bool ReplayPort::done()
+{
+	return pos >= recs.size() && rx.empty();
+}
@@ -0,0 +1,70 @@
+/*
+replay.h a HostPort that plays back a recorded ft817 trace
+
+Every frame the library sends is checked against the next TX record in the
+trace (a mismatch is counted as a divergence, so a replay doubles as a
+regression check) and the RX bytes recorded after it (the discarded ones
+too) are handed back to the library at the recorded times, scaled by the
+timing factor:
+
+	100 = original timing
+	 50 = twice as fast
+	  0 = compressed, bytes are available as soon as the frame is sent
+
+With the virtual clock (host::clockVirtual()) the port also moves the clock
+forward while the library waits for a byte, so even the original timing
+(timeouts included) replays in a few ms of CPU.
+
+	std::vector<TraceRecord> trace;
+	traceLoad("field.f8tr", trace);
+	ReplayPort replay(trace, 0);
+	host::clockVirtual();
+	Serial.attach(&replay);
+	... run the same calls the sketch did ...
+	if (replay.divergences()) { ... }
+
+*/
+
+#ifndef HOST_REPLAY_h
+#define HOST_REPLAY_h
+
+#include <deque>
+#include <vector>
+#include "host.h"
+#include "trace.h"
+
+class ReplayPort : public HostPort
+{
+	public:
+		ReplayPort(const std::vector<TraceRecord> &trace, unsigned int timing = 100);
+		void setTiming(unsigned int percent);
+
+		// HostPort
+		int available();
+		int read();
+		int peek();
+		size_t write(uint8_t data);
+
+		unsigned long frames() { return txFrames; }			// frames sent by the library
+		unsigned long divergences() { return txDiverged; }	// frames that did not match the trace
+		bool done();										// all the trace was consumed
+
+	private:
+		void schedule();			// queue the RX bytes recorded after the current TX
+		const std::vector<TraceRecord> &recs;
+		size_t pos;					// next record to use
+		unsigned int timing;
+		byte frame[5];				// frame being sent by the library
+		byte frameLen;
+		unsigned long txFrames;
+		unsigned long txDiverged;
+
+		struct Pending
+		{
+			uint64_t due;			// time in us this byte is available
+			byte data;
+		};
+		std::deque<Pending> rx;
+};
+
+#endif
@@ -0,0 +1,87 @@
+/*
+retry-bench.cpp success rate & latency of every public call vs link fault level
+
+Runs every public call against the simulated radio through a FaultPort at
+increasing fault levels (the same probability for every fault kind: RX byte
+drop/corrupt/duplicate, TX byte drop/corrupt and stale EEPROM reads) and
+reports, per call:
+
+	ok%		the call did what it should
+	flag%	it failed but the library said so (eepromValidData / false)
+	wrong%	it failed silently
+	avg/p95/max the time it took on the wire (virtual clock)
+
+The retry policy is set at build time (see the FT817_* policy defines in
+ft817.h), so to evaluate a different one just rebuild with other values:
+
+	make clean && make DEFS=-DFT817_RETRIES=1 && ./retry-bench
+
+	retry-bench [calls per op and level] [seed]
+
+*/
+
+#include <stdio.h>
+#include <algorithm>
+#include <vector>
+#include "host.h"
+#include "simradio.h"
+#include "simops.h"
+#include "faultport.h"
+#include "ft817.h"
+
+static const double levels[] = {0, 0.001, 0.003, 0.01, 0.03, 0.1};
+
+int main(int argc, char **argv)
+{
+	unsigned long calls = argc > 1 ? strtoul(argv[1], NULL, 10) : 500;
+	uint64_t seed = argc > 2 ? strtoull(argv[2], NULL, 10) : 817;
+
+	FT817 radio;
+	SimRadio sim;
+	FaultPort faults(sim, seed);
+
+	host::clockVirtual();
+	Serial.attach(&faults);
+	radio.begin(9600);
+
+	printf("retry policy: FT817_TIMEOUT=%d FT817_EEPROM_READS=%d FT817_RETRIES=%d\n",
+		FT817_TIMEOUT, FT817_EEPROM_READS, FT817_RETRIES);
+	printf("%lu calls per op and fault level, seed %llu\n", calls, (unsigned long long)seed);
+
+	for (size_t l = 0; l < sizeof(levels) / sizeof(levels[0]); l++)
+	{
+		printf("\nfault level %.1f%%\n", levels[l] * 100);
+		printf("%-14s %7s %7s %7s %9s %9s %9s\n",
+			"call", "ok%", "flag%", "wrong%", "avg ms", "p95 ms", "max ms");
+
+		for (int o = 0; o < simOpCount; o++)
+		{
+			sim.reset();
+			faults.seed(seed + l * 1000 + o);
+			faults.level(levels[l]);
+			srand(seed + o);
+
+			unsigned long outcome[3] = {0, 0, 0};
+			std::vector<uint32_t> us;
+			uint64_t total = 0;
+			for (unsigned long i = 0; i < calls; i++)
+			{
+				uint64_t start = host::clockUs();
+				outcome[simOps[o].run(radio, sim)]++;
+				us.push_back(host::clockUs() - start);
+				total += us.back();
+			}
+
+			std::sort(us.begin(), us.end());
+			printf("%-14s %7.1f %7.1f %7.1f %9.1f %9.1f %9.1f\n", simOps[o].name,
+				100.0 * outcome[SIM_OK] / calls,
+				100.0 * outcome[SIM_FLAGGED] / calls,
+				100.0 * outcome[SIM_WRONG] / calls,
+				total / 1000.0 / calls,
+				us[us.size() * 95 / 100] / 1000.0,
+				us.back() / 1000.0);
+		}
+	}
+
+	return 0;
+}
@@ -0,0 +1,116 @@
+/*
+serialport.cpp a HostPort for a real serial port (tty) on Linux
+
+*/
+
+#include <fcntl.h>
+#include <poll.h>
+#include <termios.h>
+#include <unistd.h>
+#include "serialport.h"
+
+LinuxSerialPort::LinuxSerialPort()
+{
+	port = -1;
+	waitMs = 1;
+	head = len = 0;
+}
+
+LinuxSerialPort::~LinuxSerialPort()
+{
+	close();
+}
+
+bool LinuxSerialPort::open(const char *path)
+{
+	close();
+	port = ::open(path, O_RDWR | O_NOCTTY | O_NONBLOCK | O_CLOEXEC);
+	if (port < 0) { return false; }
+	begin(9600);
+	return true;
+}
+
+void LinuxSerialPort::close()
+{
+	if (port >= 0) { ::close(port); }
+	port = -1;
+	head = len = 0;
+}
+
+// raw mode, 8 data bits, no parity, 2 stop bits as the radio wants
+void LinuxSerialPort::begin(unsigned long baud)
+{
+	if (port < 0) { return; }
+
+	speed_t speed = B9600;
+	switch (baud)
+	{
+		case 4800:		speed = B4800; break;
+		case 19200:		speed = B19200; break;
+		case 38400:		speed = B38400; break;
+	}
+
+	struct termios tio;
+	tcgetattr(port, &tio);
+	cfmakeraw(&tio);
+	tio.c_cflag |= CLOCAL | CREAD | CSTOPB;
+	tio.c_cflag &= ~(PARENB | CRTSCTS);
+	tio.c_cc[VMIN] = 0;
+	tio.c_cc[VTIME] = 0;
+	cfsetispeed(&tio, speed);
+	cfsetospeed(&tio, speed);
+	tcsetattr(port, TCSANOW, &tio);
+	tcflush(port, TCIOFLUSH);
+}
+
+void LinuxSerialPort::fill(int timeout)
+{
+	if (port < 0 || len) { return; }
+
+	if (timeout > 0)
+	{
+		struct pollfd p;
+		p.fd = port;
+		p.events = POLLIN;
+		if (poll(&p, 1, timeout) <= 0) { return; }
+	}
+
+	ssize_t n = ::read(port, buf, sizeof(buf));
+	if (n > 0)
+	{
+		head = 0;
+		len = n;
+	}
+}
+
+int LinuxSerialPort::available()
+{
+	fill(0);
+	if (!len) { fill(waitMs); }
+	return len;
+}
+
+int LinuxSerialPort::read()
+{
+	fill(0);
+	if (!len) { return -1; }
+	len--;
+	return buf[head++];
+}
+
+int LinuxSerialPort::peek()
+{
+	fill(0);
+	return len ? buf[head] : -1;
+}
+
+size_t LinuxSerialPort::write(uint8_t data)
+{
+	if (port < 0) { return 0; }
+	return ::write(port, &data, 1) == 1 ? 1 : 0;
+}
+
+void LinuxSerialPort::flush()
+{
+	if (port >= 0) { tcdrain(port); }
+}
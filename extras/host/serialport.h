@@ -0,0 +1,46 @@
+/*
+serialport.h a HostPort for a real serial port (tty) on Linux
+
+	LinuxSerialPort port;
+	if (!port.open("/dev/ttyUSB0")) { ... }
+	Serial.attach(&port);
+	radio.begin(9600);		// sets the port to 9600 8N2 raw
+
+When there is nothing to read available() waits for the port a short while
+(waitMs, 1 ms by default) so the library's wait loops do not burn a whole
+CPU core spinning.
+
+*/
+
+#ifndef HOST_SERIALPORT_h
+#define HOST_SERIALPORT_h
+
+#include "host.h"
+
+class LinuxSerialPort : public HostPort
+{
+	public:
+		LinuxSerialPort();
+		~LinuxSerialPort();
+		bool open(const char *path);	// the port is set to 9600 8N2 raw until begin()
+		void close();
+		int fd() { return port; }
+		int waitMs;						// how long available() waits for data when there is none
+
+		// HostPort
+		void begin(unsigned long baud);
+		int available();
+		int read();
+		int peek();
+		size_t write(uint8_t data);
+		void flush();
+
+	private:
+		void fill(int timeout);			// read what is pending, waiting up to timeout ms
+		int port;
+		byte buf[256];
+		int head;
+		int len;
+};
+
+#endif
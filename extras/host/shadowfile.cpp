@@ -0,0 +1,43 @@
+/*
+shadowfile.cpp keep a FT817Shadow in a file on the host
+
+See shadowfile.h
+
+*/
+
+#include <stdio.h>
+#include <unistd.h>
+#include <string>
+#include "shadowfile.h"
+
+bool shadowLoad(const char *path, FT817Shadow *shadow)
+{
+	FILE *f = fopen(path, "rb");
+	if (!f) { return false; }
+
+	bool full = fread(&shadow->data, sizeof(shadow->data), 1, f) == 1;
+	fclose(f);
+
+	return full;
+}
+
+bool shadowSave(const char *path, FT817Shadow *shadow)
+{
+	std::string aside = std::string(path) + ".new";
+	FILE *f = fopen(aside.c_str(), "wb");
+	if (!f) { return false; }
+
+	bool done = fwrite(&shadow->data, sizeof(shadow->data), 1, f) == 1;
+	done &= fflush(f) == 0;
+	done &= fsync(fileno(f)) == 0;
+	done &= fclose(f) == 0;
+	done = done && (rename(aside.c_str(), path) == 0);
+	if (!done)
+	{
+		unlink(aside.c_str());
+		return false;
+	}
+
+	shadow->dirty = false;
+	return true;
+}
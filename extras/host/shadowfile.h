@@ -0,0 +1,24 @@
+/*
+shadowfile.h keep a FT817Shadow in a file on the host (see src/ft817shadow.h)
+
+	FT817Shadow shadow;
+	shadowLoad("/var/lib/ft817/shadow", &shadow);	// a missing file is fine
+	radio.setShadow(&shadow);
+	radio.warmStart();
+	...
+	if (shadow.dirty) { shadowSave("/var/lib/ft817/shadow", &shadow); }
+
+The file is written aside and renamed over the old one, so a crash or a
+power cut leaves the old one or the new one, never half of it.
+
+*/
+
+#ifndef HOST_SHADOWFILE_h
+#define HOST_SHADOWFILE_h
+
+#include "ft817.h"
+
+bool shadowLoad(const char *path, FT817Shadow *shadow);		// false if none or short, warmStart() tells if it's good
+bool shadowSave(const char *path, FT817Shadow *shadow);		// clears dirty if saved
+
+#endif
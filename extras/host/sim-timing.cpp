@@ -0,0 +1,253 @@
+/*
+sim-timing.cpp run the library against the simulated radio on the virtual clock
+
+Runs a mixed workload of the public calls (the delays & timeouts included)
+and reports the virtual time each call takes on the wire, checking every
+answer against the simulated radio state. The same workload is run across
+the millis() wraparound and against a mute radio to exercise the timeouts.
+Then the non blocking post() & replyDone() against a full answer, a short
+one, a mute radio and a late one (thrown away by the next frame, and traced
+as such). At the end the band of a frequency, by the library and by the
+simulated radio, is compared at every band edge.
+
+	sim-timing [iterations]
+
+Exits with 1 if any answer does not match the simulated radio, a timeout
+does not expire when it should or a band edge differs.
+
+*/
+
+#include <stdio.h>
+#include <time.h>
+#include <vector>
+#include "host.h"
+#include "simradio.h"
+#include "simops.h"
+#include "ft817.h"
+#include "trace.h"
+
+FT817 radio;
+SimRadio sim;
+
+static unsigned long failures = 0;
+
+struct OpStats
+{
+	unsigned long calls;
+	uint64_t totalUs;
+	uint32_t minUs;
+	uint32_t maxUs;
+};
+
+static std::vector<OpStats> stats;
+
+static void runOp(int i)
+{
+	OpStats &op = stats[i];
+	uint64_t start = host::clockUs();
+	if (simOps[i].run(radio, sim) != SIM_OK) { failures++; }
+	uint32_t us = host::clockUs() - start;
+
+	if (!op.calls || us < op.minUs) { op.minUs = us; }
+	if (us > op.maxUs) { op.maxUs = us; }
+	op.calls++;
+	op.totalUs += us;
+}
+
+// a run of random calls
+static void workload(const char *title, uint32_t start, unsigned long iterations)
+{
+	host::clockVirtual(start);
+	sim.reset();
+	srand(817);
+	stats.assign(simOpCount, OpStats());
+
+	for (unsigned long i = 0; i < iterations; i++)
+	{
+		runOp(rand() % simOpCount);
+	}
+
+	printf("\n%s: %lu calls from millis() = %lu to %lu\n", title, iterations,
+		(unsigned long)start, millis());
+	printf("%-14s %8s %10s %10s %10s\n", "call", "count", "min ms", "avg ms", "max ms");
+	for (int i = 0; i < simOpCount; i++)
+	{
+		OpStats &op = stats[i];
+		if (!op.calls) { continue; }
+		printf("%-14s %8lu %10.1f %10.1f %10.1f\n", simOps[i].name, op.calls,
+			op.minUs / 1000.0, op.totalUs / 1000.0 / op.calls, op.maxUs / 1000.0);
+	}
+}
+
+// a mute radio, every wait must expire after 2 seconds, wrap or not
+static void timeouts(uint32_t start)
+{
+	host::clockVirtual(start);
+	sim.reset();
+	sim.mute = true;
+
+	uint32_t t0 = millis();
+	radio.getSMeter();
+	uint32_t waited = millis() - t0;
+	if (waited < 2000 || waited > 2010) { failures++; }
+	printf("\nmute radio from millis() = %lu: getSMeter() gave up after %lu ms\n",
+		(unsigned long)start, (unsigned long)waited);
+
+	t0 = millis();
+	radio.getVFO();
+	waited = millis() - t0;
+	if (radio.eepromValidData) { failures++; }
+	printf("mute radio from millis() = %lu: getVFO() gave up after %lu ms\n",
+		(unsigned long)start, (unsigned long)waited);
+
+	sim.mute = false;
+}
+
+// a radio that answers only the first bytes of the freq & mode, or all of
+// them late
+class ShortRadio : public SimRadio
+{
+	public:
+		byte count = 3;
+		void late() { reply(freqMode, 5); }
+
+	protected:
+		void answer(const byte *frame)
+		{
+			if (frame[4] != CAT_RX_FREQ_CMD) { SimRadio::answer(frame); return; }
+			reply(freqMode, count);
+		}
+
+	private:
+		const byte freqMode[5] = {0x01, 0x40, 0x70, 0x00, CAT_MODE_USB};
+};
+
+// a trace in memory
+class MemPrint : public Print
+{
+	public:
+		std::vector<byte> data;
+		size_t write(uint8_t b) { data.push_back(b); return 1; }
+		using Print::write;
+};
+
+// post() a frame and poll replyDone() as a main loop would, 1 ms a turn
+static byte exchange(byte cmd, byte *reply, uint32_t *took)
+{
+	byte frame[5];
+	FT817::frameCmd(frame, cmd);
+	uint32_t t0 = millis();
+	radio.post(frame);
+	while (!radio.replyDone()) { host::clockAdvance(1); }
+	*took = millis() - t0;
+	return radio.takeReply(reply);
+}
+
+static void check(const char *what, bool ok, byte got, uint32_t took)
+{
+	printf("%-34s %u bytes in %5lu ms  %s\n", what, got, (unsigned long)took, ok ? "ok" : "WRONG");
+	if (!ok) { failures++; }
+}
+
+// the non blocking exchange: a full answer, a short one, a mute radio, a
+// post() right after a timeout and a late answer of a timed out one
+static void posts()
+{
+	host::clockVirtual();
+	sim.reset();
+	byte reply[5];
+	uint32_t took;
+	printf("\npost() & replyDone()\n");
+
+	uint32_t t0 = millis();
+	byte n = exchange(CAT_RX_FREQ_CMD, reply, &took);
+	check("full answer", (n == 5) && (FT817::replyFreq(reply) == sim.freq[sim.vfo()]) &&
+		(reply[4] == sim.mode[sim.vfo()]) && ((uint32_t)(radio.replyAt - t0) <= took) && (took < 100), n, took);
+
+	ShortRadio partial;
+	partial.begin(9600);
+	Serial.attach(&partial);
+	n = exchange(CAT_RX_FREQ_CMD, reply, &took);
+	check("short answer", (n == 3) && (took >= FT817_TIMEOUT) && (reply[3] == 0xFF) && (reply[4] == 0xFF), n, took);
+	Serial.attach(&sim);
+
+	sim.mute = true;
+	n = exchange(CAT_RX_FREQ_CMD, reply, &took);
+	check("mute radio", (n == 0) && (took >= FT817_TIMEOUT) && (took <= FT817_TIMEOUT + 2) && (reply[0] == 0xFF), n, took);
+
+	sim.mute = false;
+	sim.smeter = 9;
+	n = exchange(CAT_RX_DATA_CMD, reply, &took);
+	check("right after a timeout", (n == 1) && ((reply[0] & 0x0F) == 9) && (took < 100), n, took);
+
+	// the answer comes after the timeout, before the next post(); the
+	// simulated radio can't be late on its own, its available() moves the
+	// virtual clock to the next byte
+	Serial.attach(&partial);
+	partial.mute = true;
+	partial.smeter = 9;
+	n = exchange(CAT_RX_FREQ_CMD, reply, &took);
+	partial.mute = false;
+	partial.late();
+	host::clockAdvance(100);
+	MemPrint mem;
+	FT817Trace trace;
+	trace.begin(mem);
+	radio.setTap(&trace);
+	byte late = exchange(CAT_RX_DATA_CMD, reply, &took);
+	radio.setTap(NULL);
+	check("after a late answer", (n == 0) && (late == 1) && ((reply[0] & 0x0F) == 9), late, took);
+
+	// the late bytes thrown away are in the trace
+	std::vector<TraceRecord> recs;
+	byte drops = 0;
+	bool parsed = traceParse(mem.data.data(), mem.data.size(), recs);
+	for (size_t i = 0; i < recs.size(); i++) { drops += recs[i].type == FT817_TRACE_DISCARD; }
+	check("late answer in the trace", parsed && (drops == 5) && (recs.back().type == FT817_TRACE_RX), drops, 0);
+	Serial.attach(&sim);
+}
+
+// the band of a freq, the library table against the radio's one at each edge
+static void bandEdges()
+{
+	unsigned long wrong = 0;
+	for (byte i = 0; i < SimRadio::bandCount; i++)
+	{
+		const SimBand &b = SimRadio::bands[i];
+		const unsigned long probe[] = {b.first / 10 - 1, b.first / 10, b.last / 10, b.last / 10 + 1};
+		for (byte p = 0; p < 4; p++)
+		{
+			if (ft817Band(probe[p]) == SimRadio::bandOf(probe[p])) { continue; }
+			printf("band of %lu Hz: library %u, radio %u\n", probe[p] * 10, ft817Band(probe[p]),
+				SimRadio::bandOf(probe[p]));
+			wrong++;
+		}
+	}
+
+	printf("\nband plan: %lu of %u edges disagree\n", wrong, SimRadio::bandCount * 4);
+	failures += wrong;
+}
+
+int main(int argc, char **argv)
+{
+	unsigned long iterations = argc > 1 ? strtoul(argv[1], NULL, 10) : 5000;
+
+	struct timespec w0, w1;
+	clock_gettime(CLOCK_MONOTONIC, &w0);
+
+	Serial.attach(&sim);
+	radio.begin(9600);
+
+	workload("from boot", 0, iterations);
+	workload("across the millis() wraparound", 0xFFFFFFFFUL - 60000UL, iterations);
+	timeouts(0);
+	timeouts(0xFFFFFFFFUL - 1000UL);
+	posts();
+	bandEdges();
+
+	clock_gettime(CLOCK_MONOTONIC, &w1);
+	double wall = (w1.tv_sec - w0.tv_sec) * 1000.0 + (w1.tv_nsec - w0.tv_nsec) / 1e6;
+
+	printf("\n%lu mismatches, %.1f ms of real time\n", failures, wall);
+	return failures ? 1 : 0;
+}
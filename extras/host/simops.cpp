@@ -0,0 +1,214 @@
+/*
+simops.cpp the public calls of the library as checkable operations against SimRadio
+
+*/
+
+#include <stdlib.h>
+#include <string.h>
+#include "simops.h"
+
+// outcome of a call with a validity flag
+static byte checked(bool valid, bool match)
+{
+	if (match && valid) { return SIM_OK; }
+	return valid ? SIM_WRONG : SIM_FLAGGED;
+}
+
+static byte opGetFreqMode(FT817 &radio, SimRadio &sim)
+{
+	return radio.getFreqMode() == sim.freq[sim.vfo()] ? SIM_OK : SIM_WRONG;
+}
+
+static byte opSetFreq(FT817 &radio, SimRadio &sim)
+{
+	unsigned long f = 1400000 + (rand() % 35000);
+	radio.setFreq(f);
+	return sim.freq[sim.vfo()] == f ? SIM_OK : SIM_WRONG;
+}
+
+static byte opSetMode(FT817 &radio, SimRadio &sim)
+{
+	byte m = (rand() & 1) ? CAT_MODE_CW : CAT_MODE_USB;
+	radio.setMode(m);
+	return sim.mode[sim.vfo()] == m ? SIM_OK : SIM_WRONG;
+}
+
+static byte opGetSMeter(FT817 &radio, SimRadio &sim)
+{
+	sim.smeter = rand() % 16;
+	return radio.getSMeter() == sim.smeter ? SIM_OK : SIM_WRONG;
+}
+
+static byte opChkTX(FT817 &radio, SimRadio &sim)
+{
+	sim.ptt = rand() & 1;
+	return radio.chkTX() == sim.ptt ? SIM_OK : SIM_WRONG;
+}
+
+static byte opGetVFO(FT817 &radio, SimRadio &sim)
+{
+	bool v = radio.getVFO();
+	return checked(radio.eepromValidData, v == sim.vfo());
+}
+
+static byte opGetBandVFO(FT817 &radio, SimRadio &sim)
+{
+	bool vfo = rand() & 1;
+	byte b = radio.getBandVFO(vfo);
+	return checked(radio.eepromValidData, b == sim.band(vfo));
+}
+
+static byte opGetDisplaySelection(FT817 &radio, SimRadio &sim)
+{
+	sim.eeprom[0x76] = (sim.eeprom[0x76] & 0xF0) | (rand() % 12);
+	byte d = radio.getDisplaySelection();
+	return checked(radio.eepromValidData, d == (sim.eeprom[0x76] & 0x0F));
+}
+
+static byte opGetNar(FT817 &radio, SimRadio &sim)
+{
+	bool n = radio.getNar();
+	return checked(radio.eepromValidData, n == (bool)bitRead(sim.eeprom[sim.vfoAddr(sim.vfo()) + 1], 4));
+}
+
+static byte opGetIPO(FT817 &radio, SimRadio &sim)
+{
+	bool n = radio.getIPO();
+	return checked(radio.eepromValidData, n == (bool)bitRead(sim.eeprom[sim.vfoAddr(sim.vfo()) + 2], 5));
+}
+
+static byte opGetKeyer(FT817 &radio, SimRadio &sim)
+{
+	bool k = radio.getKeyer();
+	return checked(radio.eepromValidData, k == (bool)bitRead(sim.eeprom[0x58], 4));
+}
+
+static byte opGetBreakIn(FT817 &radio, SimRadio &sim)
+{
+	bool k = radio.getBreakIn();
+	return checked(radio.eepromValidData, k == (bool)bitRead(sim.eeprom[0x58], 5));
+}
+
+static byte opToggleKeyer(FT817 &radio, SimRadio &sim)
+{
+	bool before = bitRead(sim.eeprom[0x58], 4);
+	bool done = radio.toggleKeyer();
+	return checked(done, before != (bool)bitRead(sim.eeprom[0x58], 4));
+}
+
+static byte opSetKeyerSpeed(FT817 &radio, SimRadio &sim)
+{
+	byte wpm = 4 + rand() % 57;
+	byte battery = sim.eeprom[0x62] & 0xC0;
+	radio.setKeyerSpeed(wpm);
+	return checked(radio.eepromValidData, sim.eeprom[0x62] == (battery | (wpm - 4)));
+}
+
+static byte opToggleVFO(FT817 &radio, SimRadio &sim)
+{
+	bool before = sim.vfo();
+	radio.toggleVFO();
+	return before != sim.vfo() ? SIM_OK : SIM_WRONG;
+}
+
+static byte opToggleNar(FT817 &radio, SimRadio &sim)
+{
+	bool b = sim.vfo();
+	unsigned int addr = sim.vfoAddr(b) + 1;
+	bool before = bitRead(sim.eeprom[addr], 4);
+	bool done = radio.toggleNar();
+	return checked(done, sim.vfo() == b && before != (bool)bitRead(sim.eeprom[addr], 4));
+}
+
+static byte opGetState(FT817 &radio, SimRadio &sim)
+{
+	sim.smeter = rand() % 16;
+	sim.ptt = false;
+
+	FT817State st;
+	bool valid = radio.getState(&st);
+
+	bool vfo = sim.vfo();
+	unsigned int base = sim.vfoAddr(vfo);
+	bool match = st.freq == sim.freq[vfo] && st.mode == sim.mode[vfo] &&
+		st.smeter == sim.smeter && !st.tx && st.pmeter == 0 &&
+		st.vfo == vfo && st.bandA == sim.band(0) && st.bandB == sim.band(1) &&
+		st.nar == (bool)bitRead(sim.eeprom[base + 1], 4) &&
+		st.ipo == (bool)bitRead(sim.eeprom[base + 2], 5) &&
+		st.breakIn == (bool)bitRead(sim.eeprom[0x58], 5) &&
+		st.keyer == (bool)bitRead(sim.eeprom[0x58], 4) &&
+		st.display == (sim.eeprom[0x76] & 0x0F);
+	return checked(valid, match);
+}
+
+static byte opReadSettings(FT817 &radio, SimRadio &sim)
+{
+	FT817Settings st;
+	bool valid = radio.readSettings(&st);
+	return checked(valid, !memcmp(st.data, &sim.eeprom[FT817_SETTINGS_START], FT817_SETTINGS_SIZE));
+}
+
+// change a few settings, and try to change the VFO & bands that must be kept
+static byte opWriteSettings(FT817 &radio, SimRadio &sim)
+{
+	byte before[FT817_SETTINGS_SIZE];
+	memcpy(before, &sim.eeprom[FT817_SETTINGS_START], FT817_SETTINGS_SIZE);
+
+	FT817Settings st;
+	memcpy(st.data, before, FT817_SETTINGS_SIZE);
+	for (int n = rand() % 4; n >= 0; n--)
+	{
+		st.data[rand() % FT817_SETTINGS_SIZE] = rand();
+	}
+	st.set<FT817_FIELD_VFO>(!sim.vfo());
+	st.set<FT817_FIELD_BAND_A>(rand() % 15);
+
+	bool done = radio.writeSettings(&st);
+
+	bool match = true;
+	for (unsigned int i = 0; i < FT817_SETTINGS_SIZE; i++)
+	{
+		byte state = ft817StateBits(FT817_SETTINGS_START + i);
+		if (sim.eeprom[FT817_SETTINGS_START + i] != ((st.data[i] & ~state) | (before[i] & state))) { match = false; }
+	}
+	return checked(done, match);
+}
+
+static byte opSetSplit(FT817 &radio, SimRadio &sim)
+{
+	unsigned long rx = 1400000 + (rand() % 35000);
+	unsigned long tx = rx + 500 + (rand() % 1000);
+	byte rxMode = (rand() & 1) ? CAT_MODE_CW : CAT_MODE_USB;
+	byte txMode = (rand() & 1) ? CAT_MODE_CW : CAT_MODE_USB;
+	bool done = radio.setSplit(rx, tx, rxMode, txMode);
+
+	bool b = sim.vfo();
+	bool match = sim.split && sim.freq[b] == rx && sim.mode[b] == rxMode &&
+		sim.freq[!b] == tx && sim.mode[!b] == txMode;
+	return checked(done, match);
+}
+
+const SimOp simOps[] = {
+	{"getFreqMode", opGetFreqMode},
+	{"setFreq", opSetFreq},
+	{"setMode", opSetMode},
+	{"getSMeter", opGetSMeter},
+	{"chkTX", opChkTX},
+	{"getVFO", opGetVFO},
+	{"getBandVFO", opGetBandVFO},
+	{"getDisplaySel", opGetDisplaySelection},
+	{"getNar", opGetNar},
+	{"getIPO", opGetIPO},
+	{"getKeyer", opGetKeyer},
+	{"getBreakIn", opGetBreakIn},
+	{"toggleKeyer", opToggleKeyer},
+	{"setKeyerSpeed", opSetKeyerSpeed},
+	{"toggleVFO", opToggleVFO},
+	{"toggleNar", opToggleNar},
+	{"getState", opGetState},
+	{"readSettings", opReadSettings},
+	{"writeSettings", opWriteSettings},
+	{"setSplit", opSetSplit},
+};
+
+const int simOpCount = sizeof(simOps) / sizeof(simOps[0]);
@@ -0,0 +1,33 @@
+/*
+simops.h the public calls of the library as checkable operations against SimRadio
+
+Each operation runs one public call and checks the outcome against the state
+of the simulated radio (read directly, not through the link):
+
+	SIM_OK		the call did what it should
+	SIM_FLAGGED	the call failed, but the library said so (eepromValidData
+				is false or the call returned false)
+	SIM_WRONG	the call failed silently, the worst case
+
+*/
+
+#ifndef HOST_SIMOPS_h
+#define HOST_SIMOPS_h
+
+#include "simradio.h"
+#include "ft817.h"
+
+#define SIM_OK			0
+#define SIM_FLAGGED		1
+#define SIM_WRONG		2
+
+struct SimOp
+{
+	const char *name;
+	byte (*run)(FT817 &radio, SimRadio &sim);
+};
+
+extern const SimOp simOps[];
+extern const int simOpCount;
+
+#endif
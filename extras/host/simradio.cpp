@@ -0,0 +1,235 @@
+/*
+simradio.cpp a simulated FT-817 on the far end of the host Serial
+
+*/
+
+#include "simradio.h"
+#include "ft817.h"
+
+// the band keys of the radio and what each one covers, in Hz, from the
+// band plan of the FT-817 manual; kept apart from the library table
+// (FT817_BANDS) on purpose, sim-timing checks one against the other
+const SimBand SimRadio::bands[] = {
+	{0,		1800000,	2000000},		// 160m
+	{1,		3500000,	4000000},		// 75/80m
+	{2,		7000000,	7300000},		// 40m
+	{3,		10100000,	10150000},		// 30m
+	{4,		14000000,	14350000},		// 20m
+	{5,		18068000,	18168000},		// 17m
+	{6,		21000000,	21450000},		// 15m
+	{7,		24890000,	24990000},		// 12m
+	{8,		28000000,	29700000},		// 10m
+	{9,		50000000,	54000000},		// 6m
+	{10,	76000000,	107999990},		// FM BCB, up to 108 MHz...
+	{11,	108000000,	137000000},		// ...where Air starts
+	{12,	144000000,	148000000},		// 2m
+	{13,	430000000,	450000000},		// UHF
+};
+const byte SimRadio::bandCount = sizeof(SimRadio::bands) / sizeof(SimRadio::bands[0]);
+
+byte SimRadio::bandOf(unsigned long freq)
+{
+	unsigned long hz = freq * 10;
+	for (byte i = 0; i < bandCount; i++)
+	{
+		if ((hz >= bands[i].first) && (hz <= bands[i].last)) { return bands[i].code; }
+	}
+
+	return 0xFF;
+}
+
+static unsigned long simFromBCD(const byte *b)
+{
+	unsigned long f = 0;
+	for (byte i = 0; i < 4; i++)
+	{
+		f = f * 100 + (b[i] >> 4) * 10 + (b[i] & 0x0F);
+	}
+	return f;
+}
+
+static void simToBCD(unsigned long f, byte *b)
+{
+	for (int i = 3; i >= 0; i--)
+	{
+		byte lo = f % 10;
+		f /= 10;
+		b[i] = ((f % 10) << 4) | lo;
+		f /= 10;
+	}
+}
+
+SimRadio::SimRadio()
+{
+	byteUs = 1146;		// 9600 8N2
+	latencyUs = 2000;
+	mute = false;
+	frameGapUs = 20000;
+	reset();
+}
+
+void SimRadio::reset()
+{
+	memset(eeprom, 0, sizeof(eeprom));
+	eeprom[0x59] = 0x44;		// both VFOs on 20m
+	freq[0] = freq[1] = 1407000;
+	mode[0] = mode[1] = CAT_MODE_USB;
+	ptt = split = lock = clar = false;
+	smeter = 0;
+	pmeter = 0;
+	frames = eepromReads = eepromWrites = 0;
+	frameLen = 0;
+	lastByte = 0;
+	rx.clear();
+}
+
+void SimRadio::begin(unsigned long baud)
+{
+	// start, 8 data & 2 stop bits
+	byteUs = 11000000UL / baud;
+}
+
+void SimRadio::setVFO(bool b)
+{
+	eeprom[0x55] = (eeprom[0x55] & 0xFE) | (b ? 1 : 0);
+}
+
+// bytes ready, in virtual clock mode the clock jumps to the next byte
+int SimRadio::available()
+{
+	uint64_t now = host::clockUs();
+	int count = 0;
+	for (size_t i = 0; i < rx.size() && rx[i].due <= now; i++)
+	{
+		count++;
+	}
+
+	if (count || !host::clockIsVirtual()) { return count; }
+
+	if (rx.empty())
+	{
+		host::clockAdvance(1);
+		return 0;
+	}
+
+	host::clockAdvanceUs(rx.front().due - now);
+	return available();
+}
+
+int SimRadio::read()
+{
+	if (rx.empty() || rx.front().due > host::clockUs()) { return -1; }
+	byte data = rx.front().data;
+	rx.pop_front();
+	return data;
+}
+
+int SimRadio::peek()
+{
+	if (rx.empty() || rx.front().due > host::clockUs()) { return -1; }
+	return rx.front().data;
+}
+
+size_t SimRadio::write(uint8_t data)
+{
+	// the radio forgets a partial frame after a while, so a lost
+	// byte does not misalign all the frames that come after it
+	uint64_t now = host::clockUs();
+	if (frameLen && now - lastByte > frameGapUs) { frameLen = 0; }
+	lastByte = now;
+
+	frame[frameLen++] = data;
+	if (frameLen == 5)
+	{
+		frameLen = 0;
+		frames++;
+		if (!mute) { answer(frame); }
+	}
+	return 1;
+}
+
+// queue an answer, it starts after the frame is on the wire plus the
+// radio latency, or after the previous answer if there is one pending
+void SimRadio::reply(const byte *data, byte count)
+{
+	uint64_t due = host::clockUs() + 5 * byteUs + latencyUs;
+	if (!rx.empty() && rx.back().due > due) { due = rx.back().due; }
+
+	for (byte i = 0; i < count; i++)
+	{
+		due += byteUs;
+		Pending p;
+		p.due = due;
+		p.data = data[i];
+		rx.push_back(p);
+	}
+}
+
+void SimRadio::answer(const byte *f)
+{
+	byte ack = 0x00;
+	byte out[5];
+	bool b = vfo();
+
+	switch (f[4])
+	{
+		case CAT_RX_FREQ_CMD:
+			simToBCD(freq[b], out);
+			out[4] = mode[b];
+			reply(out, 5);
+			return;
+
+		case CAT_RX_DATA_CMD:
+			out[0] = (smeter ? 0x80 : 0x00) | (smeter & 0x0F);
+			reply(out, 1);
+			return;
+
+		case CAT_TX_DATA_CMD:
+			out[0] = (ptt ? 0x00 : 0x80) | (split ? 0x00 : 0x20) | (pmeter & 0x0F);
+			reply(out, 1);
+			return;
+
+		case 0xBB:
+		{
+			unsigned int addr = ((unsigned int)f[0] << 8) | f[1];
+			out[0] = addr < SIM_EEPROM_SIZE ? eeprom[addr] : 0xFF;
+			out[1] = addr + 1 < SIM_EEPROM_SIZE ? eeprom[addr + 1] : 0xFF;
+			eepromReads++;
+			reply(out, 2);
+			return;
+		}
+
+		case 0xBC:
+		{
+			unsigned int addr = ((unsigned int)f[0] << 8) | f[1];
+			if (addr < SIM_EEPROM_SIZE) { eeprom[addr] = f[2]; }
+			if (addr + 1 < SIM_EEPROM_SIZE) { eeprom[addr + 1] = f[3]; }
+			eepromWrites++;
+			break;
+		}
+
+		case CAT_FREQ_SET:
+		{
+			freq[b] = simFromBCD(f);
+			byte band = bandOf(freq[b]);
+			if (band != 0xFF)
+			{
+				eeprom[0x59] = b ? (eeprom[0x59] & 0x0F) | (band << 4) : (eeprom[0x59] & 0xF0) | band;
+			}
+			break;
+		}
+
+		case CAT_MODE_SET:		mode[b] = f[0]; break;
+		case CAT_VFO_AB:		setVFO(!b); break;
+		case CAT_LOCK_ON:		ack = lock ? 0xF0 : 0x00; lock = true; break;
+		case CAT_LOCK_OFF:		ack = lock ? 0x00 : 0xF0; lock = false; break;
+		case CAT_PTT_ON:		ack = ptt ? 0xF0 : 0x00; ptt = true; break;
+		case CAT_PTT_OFF:		ack = ptt ? 0x00 : 0xF0; ptt = false; break;
+		case CAT_SPLIT_ON:		split = true; break;
+		case CAT_SPLIT_OFF:		split = false; break;
+		case CAT_CLAR_ON:		clar = true; break;
+		case CAT_CLAR_OFF:		clar = false; break;
+	}
+
+	reply(&ack, 1);
+}
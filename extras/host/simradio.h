@@ -0,0 +1,99 @@
+/*
+simradio.h a simulated FT-817 on the far end of the host Serial
+
+It answers the CAT frames the library uses (freq/mode, RX/TX status, the
+toggles, EEPROM read/write) out of a full EEPROM image and a small radio
+state, with a timing model for the serial line: the answer starts after the
+frame is on the wire plus the radio latency and every byte takes the time
+it takes at the configured baud rate.
+
+With the virtual clock the peer is what moves the time: when the library is
+waiting for a byte the clock jumps right to the moment it arrives (or 1 ms
+at a time when nothing is coming, so the library timeouts expire).
+
+	host::clockVirtual(0xFFFFF000);	// start near the millis() wraparound
+	SimRadio sim;
+	Serial.attach(&sim);
+	radio.begin(9600);
+
+*/
+
+#ifndef HOST_SIMRADIO_h
+#define HOST_SIMRADIO_h
+
+#include <deque>
+#include "host.h"
+
+#define SIM_EEPROM_SIZE		0x1A00
+
+// a band key of the radio, first & last freq in Hz
+struct SimBand
+{
+	byte code;						// as in 0x59, see getBandVFO()
+	unsigned long first;
+	unsigned long last;
+};
+
+class SimRadio : public HostPort
+{
+	public:
+		SimRadio();
+		void reset();					// factory state: VFO A, 20m, 14.070 USB on both VFOs
+
+		// HostPort
+		void begin(unsigned long baud);
+		int available();
+		int read();
+		int peek();
+		size_t write(uint8_t data);
+
+		// timing model
+		uint32_t byteUs;				// time of a byte on the wire, set by begin() (8N2)
+		uint32_t latencyUs;				// radio processing time before the first answer byte
+		bool mute;						// do not answer anything
+		uint32_t frameGapUs;			// a partial frame is dropped after this silence
+
+		// radio state
+		byte eeprom[SIM_EEPROM_SIZE];
+		unsigned long freq[2];			// per VFO, in 10' of Hz
+		byte mode[2];					// per VFO
+		bool ptt;
+		bool split;
+		bool lock;
+		bool clar;
+		byte smeter;					// 0-15
+		byte pmeter;					// 0-15
+
+		// helpers
+		bool vfo() { return eeprom[0x55] & 0x01; }
+		void setVFO(bool b);
+		byte band(bool b) { return b ? eeprom[0x59] >> 4 : eeprom[0x59] & 0x0F; }
+		unsigned int vfoAddr(bool b) { return 0x7D + (b ? 390 : 0) + band(b) * 26; }
+
+		// the band plan of the radio, freq in 10' of Hz, 0xFF if in none
+		static const SimBand bands[];
+		static const byte bandCount;
+		static byte bandOf(unsigned long freq);
+
+		// stats
+		unsigned long frames;			// frames received
+		unsigned long eepromReads;
+		unsigned long eepromWrites;
+
+	protected:
+		virtual void answer(const byte *frame);	// process a frame, queue the answer with reply()
+		void reply(const byte *data, byte count);
+
+	private:
+		struct Pending
+		{
+			uint64_t due;				// time in us this byte is available
+			byte data;
+		};
+		std::deque<Pending> rx;
+		byte frame[5];
+		byte frameLen;
+		uint64_t lastByte;				// time of the last byte received
+};
+
+#endif
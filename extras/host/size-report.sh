@@ -0,0 +1,122 @@
+#!/bin/sh
+#
+# size-report.sh flash & RAM footprint of the ft817 library per build profile
+#
+#	size-report.sh [-s baseline] [-b baseline]
+#
+# Builds every src/*.cpp once per profile (see src/ft817config.h) for an
+# ATmega328P, the way the Arduino IDE does (avr-g++ -Os, one section per
+# function), and lists the code (text), initialized data (data, in flash AND
+# in RAM) and zeroed RAM (bss) of each file and the totals: flash is
+# text + data, RAM is data + bss. It's the library alone, the linker drops
+# the functions a sketch never calls.
+#
+#	-s file		save the totals to file
+#	-b file		compare with the saved ones, exit with 1 if a profile takes
+#				more than SLACK bytes (16) of flash or any byte of RAM more
+#
+# No baseline is shipped, the sizes depend on the avr-gcc & core versions:
+# save one with -s on your toolchain before a change, -b after it.
+#
+# It needs avr-g++, avr-size and the Arduino AVR core: it's looked up in
+# ~/.arduino15 and /usr/share/arduino, or set ARDUINO_AVR to the folder with
+# cores/ & variants/ in it. With HOST=1 it builds with g++ & the shim in this
+# folder instead, just to check that every profile compiles (x86 sizes).
+# MODEL=857 (or 897) builds for that model (see src/ft817model.h).
+
+cd "$(dirname "$0")" || exit 1
+
+SRC=../../src
+PROFILES="READ CAT FULL"
+SLACK=${SLACK:-16}
+SAVE=
+BASE=
+
+while getopts "s:b:" opt
+do
+	case $opt in
+		s) SAVE=$OPTARG ;;
+		b) BASE=$OPTARG ;;
+		*) sed -n '3,25p' "$0" | sed 's/^# \{0,1\}//'; exit 2 ;;
+	esac
+done
+
+if [ -n "$HOST" ]
+then
+	CXX=${CXX:-g++}
+	SIZE=${SIZE:-size}
+	FLAGS="-Os -std=gnu++11 -ffunction-sections -fdata-sections -I. -DUse_HW_Serial="
+	TARGET="host (x86, only a compile check)"
+else
+	CXX=${CXX:-avr-g++}
+	SIZE=${SIZE:-avr-size}
+	if [ -z "$ARDUINO_AVR" ]
+	then
+		for d in $HOME/.arduino15/packages/arduino/hardware/avr/* /usr/share/arduino/hardware/arduino/avr
+		do
+			[ -d "$d/cores/arduino" ] && ARDUINO_AVR=$d
+		done
+	fi
+	if [ -z "$ARDUINO_AVR" ] || ! command -v "$CXX" > /dev/null
+	then
+		echo "no avr-g++ or Arduino AVR core, install them or set ARDUINO_AVR (or HOST=1)" >&2
+		exit 2
+	fi
+	FLAGS="-Os -std=gnu++11 -fno-exceptions -fno-threadsafe-statics -ffunction-sections -fdata-sections \
+		-mmcu=atmega328p -DF_CPU=16000000L -DARDUINO=10819 -DARDUINO_AVR_UNO -DARDUINO_ARCH_AVR \
+		-I$ARDUINO_AVR/cores/arduino -I$ARDUINO_AVR/variants/standard"
+	TARGET="ATmega328P, $($CXX -dumpversion)"
+fi
+
+if [ -n "$MODEL" ]
+then
+	FLAGS="$FLAGS -DFT817_MODEL=FT817_MODEL_$MODEL"
+	TARGET="$TARGET, FT-$MODEL"
+fi
+
+TMP=$(mktemp -d) || exit 1
+trap 'rm -rf "$TMP"' EXIT
+
+echo "ft817 library footprint, $TARGET"
+for p in $PROFILES
+do
+	echo
+	printf "%-18s %7s %7s %7s\n" "FT817_PROFILE_$p" text data bss
+	: > "$TMP/$p"
+	for f in $SRC/*.cpp
+	do
+		o="$TMP/$p-$(basename "$f" .cpp).o"
+		if ! $CXX $FLAGS -DFT817_PROFILE=FT817_PROFILE_$p -c -o "$o" "$f"
+		then
+			echo "$f does not build with FT817_PROFILE_$p" >&2
+			exit 1
+		fi
+		$SIZE "$o" | awk -v f="$(basename "$f")" 'NR == 2 { printf "%-18s %7d %7d %7d\n", f, $1, $2, $3 }' | tee -a "$TMP/$p"
+	done
+	awk -v p="$p" '{ t += $2; d += $3; b += $4 }
+		END { printf "%-18s %7d %7d %7d\n", "total", t, d, b; printf "%s %d %d\n", p, t + d, d + b >> "'"$TMP/totals"'" }' "$TMP/$p"
+done
+
+echo
+printf "%-18s %7s %7s\n" profile flash ram
+awk '{ printf "%-18s %7d %7d\n", "FT817_PROFILE_" $1, $2, $3 }' "$TMP/totals"
+
+if [ -n "$SAVE" ]
+then
+	cp "$TMP/totals" "$SAVE"
+	echo "saved to $SAVE"
+fi
+
+if [ -n "$BASE" ]
+then
+	echo
+	awk -v slack="$SLACK" 'NR == FNR { flash[$1] = $2; ram[$1] = $3; next }
+		($1 in flash) {
+			df = $2 - flash[$1]; dr = $3 - ram[$1]
+			bad = (df > slack) || (dr > 0)
+			printf "%-18s flash %+6d ram %+5d  %s\n", "FT817_PROFILE_" $1, df, dr, bad ? "GREW" : "ok"
+			fail += bad
+		}
+		END { exit fail ? 1 : 0 }' "$BASE" "$TMP/totals"
+	exit $?
+fi
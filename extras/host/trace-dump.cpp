@@ -0,0 +1,60 @@
+/*
+trace-dump.cpp print a ft817 binary trace in human readable form
+
+	trace-dump field.f8tr
+
+*/
+
+#include <stdio.h>
+#include "trace.h"
+
+int main(int argc, char **argv)
+{
+	if (argc != 2)
+	{
+		fprintf(stderr, "usage: %s <trace>\n", argv[0]);
+		return 2;
+	}
+
+	std::vector<TraceRecord> trace;
+	bool valid = traceLoad(argv[1], trace);
+	if (!valid && trace.empty())
+	{
+		fprintf(stderr, "%s: not a valid trace\n", argv[1]);
+		return 1;
+	}
+
+	unsigned long tx = 0, rx = 0, timeouts = 0, discarded = 0;
+	for (size_t i = 0; i < trace.size(); i++)
+	{
+		const TraceRecord &r = trace[i];
+		printf("%10llu +%-6u ", (unsigned long long)r.time, r.delta);
+		switch (r.type)
+		{
+			case FT817_TRACE_TX:
+				printf("TX   %02X %02X %02X %02X %02X\n",
+					r.data[0], r.data[1], r.data[2], r.data[3], r.data[4]);
+				tx++;
+				break;
+			case FT817_TRACE_RX:
+				printf("RX   %02X\n", r.data[0]);
+				rx++;
+				break;
+			case FT817_TRACE_TIMEOUT:
+				printf("TIMEOUT\n");
+				timeouts++;
+				break;
+			case FT817_TRACE_DISCARD:
+				printf("DROP %02X\n", r.data[0]);
+				discarded++;
+				break;
+			default:
+				printf("MARK %u\n", r.data[0]);
+		}
+	}
+
+	printf("# %lu frames sent, %lu bytes received, %lu timeouts, %lu stale bytes discarded%s\n",
+		tx, rx, timeouts, discarded, valid ? "" : " (truncated trace)");
+
+	return valid ? 0 : 1;
+}
@@ -0,0 +1,88 @@
+/*
+trace.cpp host side reader for the ft817 binary traces
+
+*/
+
+#include "trace.h"
+
+bool traceParse(const byte *data, size_t size, std::vector<TraceRecord> &out)
+{
+	out.clear();
+
+	// header
+	if (size < 6 || memcmp(data, "F8TR", 4) != 0 || data[4] < 1 || data[4] > FT817_TRACE_VERSION)
+	{
+		return false;
+	}
+	byte version = data[4];
+
+	size_t i = 6;
+	uint64_t time = 0;
+	while (i < size)
+	{
+		TraceRecord r;
+		memset(&r, 0, sizeof(r));
+		r.type = data[i] >> 6;
+		r.delta = data[i] & 0x3F;
+		i++;
+
+		// extended delta
+		if (r.delta == FT817_TRACE_DELTA_EXT)
+		{
+			uint32_t ext = 0;
+			byte shift = 0;
+			byte b;
+			do
+			{
+				if (i >= size || shift > 28) { return false; }
+				b = data[i++];
+				ext |= (uint32_t)(b & 0x7F) << shift;
+				shift += 7;
+			} while (b & 0x80);
+			r.delta += ext;
+		}
+
+		// payload
+		size_t len = 0;
+		if (r.type == FT817_TRACE_TX) { len = 5; }
+		if (r.type == FT817_TRACE_RX || r.type == FT817_TRACE_MARK) { len = 1; }
+
+		// a LOST record has its kind since version 2
+		if (r.type == FT817_TRACE_TIMEOUT && version > 1)
+		{
+			if (i >= size) { return false; }
+			if (data[i++] == FT817_TRACE_LOST_DISCARD)
+			{
+				r.type = FT817_TRACE_DISCARD;
+				len = 1;
+			}
+		}
+
+		if (i + len > size) { return false; }
+		memcpy(r.data, &data[i], len);
+		i += len;
+
+		time += r.delta;
+		r.time = time;
+		out.push_back(r);
+	}
+
+	return true;
+}
+
+bool traceLoad(const char *path, std::vector<TraceRecord> &out)
+{
+	FILE *f = fopen(path, "rb");
+	if (!f) { return false; }
+
+	std::vector<byte> data;
+	byte chunk[4096];
+	size_t n;
+	while ((n = fread(chunk, 1, sizeof(chunk), f)) > 0)
+	{
+		data.insert(data.end(), chunk, chunk + n);
+	}
+	fclose(f);
+
+	return traceParse(data.data(), data.size(), out);
+}
@@ -0,0 +1,40 @@
+/*
+trace.h host side reader for the ft817 binary traces (see src/ft817trace.h)
+
+*/
+
+#ifndef HOST_TRACE_h
+#define HOST_TRACE_h
+
+#include <stdio.h>
+#include <vector>
+#include <Arduino.h>
+#include "ft817trace.h"
+
+struct TraceRecord
+{
+	byte type;			// FT817_TRACE_TX/RX/TIMEOUT/MARK/DISCARD
+	uint32_t delta;		// ms since the previous record
+	uint64_t time;		// ms since the start of the trace
+	byte data[5];		// frame (TX), byte (RX, DISCARD) or id (MARK)
+};
+
+// parse a trace from memory or a file, false if it's not a valid trace,
+// on a truncated trace the complete records are kept and false is returned
+bool traceParse(const byte *data, size_t size, std::vector<TraceRecord> &out);
+bool traceLoad(const char *path, std::vector<TraceRecord> &out);
+
+// a Print that writes to a stdio FILE, use it to record traces on the host
+class FilePrint : public Print
+{
+	public:
+		FilePrint(FILE *f) : file(f) { }
+		size_t write(uint8_t data) { return fputc(data, file) == EOF ? 0 : 1; }
+		size_t write(const uint8_t *data, size_t size) { return fwrite(data, 1, size, file); }
+		using Print::write;
+
+	private:
+		FILE *file;
+};
+
+#endif
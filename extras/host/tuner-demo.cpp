@@ -0,0 +1,130 @@
+/*
+tuner-demo.cpp a fast tuning knob: a setFreq() per step vs FT817Tuner
+
+A rotary encoder sends a step every few ms for a while and then stops, on
+the simulated radio and the virtual clock. First every step is a blocking
+setFreq(), then the steps go to a FT817Tuner. For both it reports the
+frames sent, the lag from a knob step to the radio tuning to it (when it
+does, the tuner skips the intermediate ones) and how long after the knob
+stops the radio is on the final frequency.
+
+	tuner-demo [step ms] [steps]
+
+Exits with 1 if the radio does not end on the last frequency or update()
+ever calls delay().
+
+*/
+
+#include <stdio.h>
+#include "host.h"
+#include "simradio.h"
+#include "ft817.h"
+#include "ft817tuner.h"
+
+static const unsigned long start = 1407000;
+
+struct Result
+{
+	unsigned long frames;
+	uint32_t maxLag;
+	uint64_t totalLag;
+	unsigned long seen;			// knob positions the radio was tuned to
+	uint32_t settle;
+};
+
+static uint32_t stepMs;
+static unsigned long steps;
+static SimRadio sim;
+
+// the knob position at a time, and the time of a position
+static unsigned long knob(uint32_t t) { return start + (t / stepMs < steps ? t / stepMs : steps - 1); }
+static uint32_t when(unsigned long f) { return (f - start) * stepMs; }
+
+// take note of the lag if the radio has a new frequency
+static void watch(Result &r, unsigned long &last)
+{
+	unsigned long f = sim.freq[sim.vfo()];
+	if (f == last) { return; }
+	last = f;
+
+	uint32_t lag = millis() - when(f);
+	if (lag > r.maxLag) { r.maxLag = lag; }
+	r.totalLag += lag;
+	r.seen++;
+}
+
+static void report(const char *title, Result &r)
+{
+	printf("%-14s %7lu %7lu %9.1f %9lu %10lu\n", title, r.frames, r.seen,
+		r.totalLag / (double)r.seen, (unsigned long)r.maxLag, (unsigned long)r.settle);
+}
+
+int main(int argc, char **argv)
+{
+	stepMs = argc > 1 ? atoi(argv[1]) : 2;
+	steps = argc > 2 ? atoi(argv[2]) : 1000;
+	uint32_t end = (steps - 1) * stepMs;
+	int failures = 0;
+
+	FT817 radio;
+	Serial.attach(&sim);
+	radio.begin(9600);
+
+	// a blocking setFreq() per step
+	host::clockVirtual();
+	sim.reset();
+	Result b = {};
+	unsigned long last = sim.freq[sim.vfo()];
+	unsigned long f0 = sim.frames;
+	for (unsigned long i = 0; i < steps; i++)
+	{
+		if (millis() < when(start + i)) { host::clockAdvance(when(start + i) - millis()); }
+		radio.setFreq(start + i);
+		watch(b, last);
+	}
+	b.frames = sim.frames - f0;
+	b.settle = millis() - end;
+	if (sim.freq[sim.vfo()] != knob(end)) { failures++; }
+
+	// the tuner
+	host::clockVirtual();
+	sim.reset();
+	FT817Tuner tuner;
+	tuner.begin(radio);
+	Result t = {};
+	last = sim.freq[sim.vfo()];
+	f0 = sim.frames;
+	unsigned long asked = 0;
+	uint64_t blocked = 0;		// us in delay() within update()
+	while (true)
+	{
+		// the encoder code, a tune() per step
+		unsigned long k = knob(millis());
+		while (asked < k) { tuner.tune(asked = (asked ? asked + 1 : start)); }
+
+		uint64_t d0 = host::delayedUs();
+		bool busy = tuner.update();
+		blocked += host::delayedUs() - d0;
+		watch(t, last);
+
+		if (!busy)
+		{
+			if (millis() >= end && asked == knob(end)) { break; }
+			host::clockAdvance(1);		// waiting for the knob
+		}
+	}
+	t.frames = sim.frames - f0;
+	t.settle = millis() - end;
+	if (sim.freq[sim.vfo()] != knob(end)) { failures++; }
+
+	printf("%lu steps, one every %lu ms (%.1f s of knob spinning)\n",
+		steps, (unsigned long)stepMs, end / 1000.0);
+	printf("%-14s %7s %7s %9s %9s %10s\n", "", "frames", "tuned", "avg lag", "max lag", "settle ms");
+	report("setFreq()", b);
+	report("FT817Tuner", t);
+	printf("tuner: %lu requests coalesced, last lag %lu ms, max %lu ms, %.1f ms blocked in update()  %s\n",
+		tuner.coalesced, tuner.lag, tuner.maxLag, blocked / 1000.0, blocked ? "WRONG" : "ok");
+	if (blocked) { failures++; }
+
+	return failures ? 1 : 0;
+}
@@ -0,0 +1,217 @@
+/*
+warm-demo.cpp time to the first screen with and without a FT817Shadow
+
+A controller starts and needs the settings (readSettings()) and the status
+(getState()) to draw its first screen. On the simulated radio and the
+virtual clock, it starts:
+
+	cold		no shadow, all read from the radio
+	first		a shadow but no file yet, it's read in full and saved
+	warm		the saved shadow
+	moved		the saved shadow, the radio went to VFO B on another band
+				and NAR was toggled while the controller was off
+	other		the saved shadow, but on another radio (other settings)
+	corrupt		a damaged file
+
+	mute		the radio does not answer during warmStart(), it's saved as
+				it's left, then a start with the radio back
+
+For each one it reports the time to the first screen, the frames and the
+EEPROM reads it took, if the start was warm and if what it got is what a
+live read gives. It checks that a read before warmStart() leaves the loaded
+shadow as it was and that a failed warmStart() does not leave it valid.
+Then a change on the front panel with the shadow live: the refreshShadow()
+calls (one a second) until a get<>() sees it.
+
+	warm-demo [file]
+
+Exits with 1 if a screen does not match the radio.
+
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "host.h"
+#include "simradio.h"
+#include "ft817.h"
+#include "shadowfile.h"
+
+static SimRadio sim;
+static FT817 radio;
+
+struct Screen
+{
+	FT817Settings settings;
+	FT817State state;
+};
+
+static bool same(const Screen &a, const Screen &b)
+{
+	const FT817State &x = a.state;
+	const FT817State &y = b.state;
+	return !memcmp(a.settings.data, b.settings.data, FT817_SETTINGS_SIZE) &&
+		(x.freq == y.freq) && (x.mode == y.mode) && (x.tx == y.tx) && (x.smeter == y.smeter) &&
+		(x.pmeter == y.pmeter) && (x.vfo == y.vfo) && (x.bandA == y.bandA) && (x.bandB == y.bandB) &&
+		(x.nar == y.nar) && (x.ipo == y.ipo) && (x.breakIn == y.breakIn) && (x.keyer == y.keyer) &&
+		(x.display == y.display);
+}
+
+static bool draw(Screen *s)
+{
+	return radio.readSettings(&s->settings) & radio.getState(&s->state);
+}
+
+// a radio with its menus set, seeded
+static void configure(unsigned seed)
+{
+	sim.reset();
+	srand(seed);
+	for (unsigned int a = FT817_SETTINGS_START; a < FT817_VFO_BASE; a++)
+	{
+		sim.eeprom[a] = (sim.eeprom[a] & ft817StateBits(a)) | (rand() & ~ft817StateBits(a));
+	}
+}
+
+// start the controller, with a shadow (and a file) or not
+static int start(const char *name, const char *path, bool shadowed)
+{
+	host::clockVirtual();
+	unsigned long f0 = sim.frames;
+	unsigned long r0 = sim.eepromReads;
+
+	FT817Shadow shadow;
+	if (shadowed)
+	{
+		shadowLoad(path, &shadow);
+		radio.setShadow(&shadow);
+		radio.warmStart();
+	}
+
+	Screen got;
+	bool ok = draw(&got);
+	uint32_t took = millis();
+	unsigned long frames = sim.frames - f0;
+	unsigned long reads = sim.eepromReads - r0;
+
+	if (shadowed && shadow.dirty) { shadowSave(path, &shadow); }
+
+	// what the radio really has
+	radio.setShadow(NULL);
+	Screen live;
+	ok &= draw(&live) && same(got, live);
+
+	printf("%-8s %8lu %7lu %7lu  %-4s  %s\n", name, (unsigned long)took, frames, reads,
+		!shadowed ? "-" : shadow.warm ? "yes" : "no", ok ? "ok" : "WRONG");
+	return ok ? 0 : 1;
+}
+
+// a read before warmStart() must not touch the loaded copy, and a mute radio
+// must not leave it valid to be saved
+static int early(const char *path)
+{
+	host::clockVirtual();
+	FT817Shadow shadow;
+	shadowLoad(path, &shadow);
+	FT817ShadowData loaded = shadow.data;
+	radio.setShadow(&shadow);
+
+	// a settings pair changed while off, read before the warm start
+	FT817Settings settings;
+	unsigned int address = FT817_SETTINGS_START + 8;
+	byte was = sim.eeprom[address];
+	sim.eeprom[address] ^= 0xFF & ~ft817StateBits(address);
+	radio.readSettings(&settings);
+	sim.eeprom[address] = was;
+	bool untouched = !memcmp(&loaded, &shadow.data, sizeof(loaded)) && shadow.valid();
+
+	sim.mute = true;
+	bool live = radio.warmStart();
+	sim.mute = false;
+	bool invalid = !shadow.valid();
+	if (shadow.dirty) { shadowSave(path, &shadow); }
+	radio.setShadow(NULL);
+
+	bool ok = untouched && !live && invalid;
+	printf("read before warmStart() %s, mute radio %s  %s\n", untouched ? "left it alone" : "CHANGED it",
+		invalid ? "left it invalid" : "LEFT IT VALID", ok ? "ok" : "WRONG");
+	return ok ? 0 : 1;
+}
+
+// a change on the front panel, the refreshShadow() calls until it's seen
+static int panel(const char *path)
+{
+	host::clockVirtual();
+	FT817Shadow shadow;
+	shadowLoad(path, &shadow);
+	radio.setShadow(&shadow);
+	radio.warmStart();
+
+	bool before = radio.getNar();
+	sim.eeprom[sim.vfoAddr(sim.vfo()) + 1] ^= 0x10;		// NAR
+	uint32_t at = millis();
+
+	unsigned long calls = 0;
+	while ((radio.getNar() == before) && (calls < 2 * FT817_SHADOW_STEPS))
+	{
+		host::clockAdvance(1000);
+		radio.refreshShadow();
+		calls++;
+	}
+
+	bool ok = radio.getNar() != before;
+	printf("front panel NAR seen after %lu refreshShadow() calls, %.1f s at one a second  %s\n",
+		calls, (millis() - at) / 1000.0, ok ? "ok" : "WRONG");
+
+	radio.setShadow(NULL);
+	return ok ? 0 : 1;
+}
+
+int main(int argc, char **argv)
+{
+	const char *path = argc > 1 ? argv[1] : "/tmp/warm-demo.shadow";
+	unlink(path);
+
+	Serial.attach(&sim);
+	radio.begin(9600);
+	configure(1);
+
+	int failures = 0;
+	printf("%-8s %8s %7s %7s  %-4s\n", "start", "ms", "frames", "reads", "warm");
+	failures += start("cold", path, false);
+	failures += start("first", path, true);
+	failures += start("warm", path, true);
+
+	// off, the radio goes to VFO B on 2m with NAR toggled
+	sim.setVFO(1);
+	sim.eeprom[0x59] = (sim.eeprom[0x59] & 0x0F) | (12 << 4);
+	sim.freq[1] = 14500000;
+	sim.eeprom[sim.vfoAddr(1) + 1] ^= 0x10;
+	failures += start("moved", path, true);
+
+	// the same file on another radio
+	configure(2);
+	failures += start("other", path, true);
+
+	// damaged
+	FILE *f = fopen(path, "r+b");
+	if (f)
+	{
+		fseek(f, 10, SEEK_SET);
+		fputc(0x5A, f);
+		fclose(f);
+	}
+	failures += start("corrupt", path, true);
+
+	// the radio off during warmStart()
+	printf("\n");
+	failures += early(path);
+	failures += start("mute", path, true);
+
+	printf("\n");
+	failures += panel(path);
+
+	unlink(path);
+	return failures ? 1 : 0;
+}
@@ -0,0 +1,195 @@
+/*
+wear-demo.cpp EEPROM writes of a buggy UI with and without a FT817Wear
+
+On the simulated radio and the virtual clock, three bad cases for a minute:
+
+	stuck	a UI toggling the keyer every 100 ms
+	bounce	a bouncing narrow button, two toggles 50 ms apart every 2 s
+	sweep	a scanner toggling the narrow on each of the 14 bands in turn,
+			one every 300 ms: more addresses than FT817_WEAR_SLOTS
+
+each one without a governor and with a FT817Wear (default interval), then
+the held writes are flushed. Reports the EEPROM write frames the radio got,
+the ones that came sooner than the interval after the last one to the same
+address (early, for both bytes each frame writes), the time on the wire, the writes held, merged & refused
+and if the radio ended as it should (an odd count of the toggles that were
+not refused flips the bit, an even one leaves it).
+
+	wear-demo [interval ms]
+
+Exits with 1 if the radio does not end as it should, a write with the
+governor is early or the governor counts a byte less than the radio wrote
+it (both bytes of each frame, i.e. the 0x59 of the keyer toggle at 0x58).
+
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "host.h"
+#include "simradio.h"
+#include "ft817.h"
+
+// the simulated radio, keeping the time of the last write of each address
+// and the writes of each one; a frame writes two
+class WearRadio : public SimRadio
+{
+	public:
+		uint32_t interval = FT817_WEAR_INTERVAL;
+		unsigned long early = 0;		// writes sooner than interval after the last one
+		uint32_t last[SIM_EEPROM_SIZE];
+		unsigned long writes[SIM_EEPROM_SIZE];
+
+		void clear()
+		{
+			early = 0;
+			memset(writes, 0, sizeof(writes));
+		}
+
+	protected:
+		void answer(const byte *frame)
+		{
+			unsigned int address = ((unsigned int)frame[0] << 8) | frame[1];
+			for (unsigned int a = address; (frame[4] == 0xBC) && (a < address + 2) && (a < SIM_EEPROM_SIZE); a++)
+			{
+				if (writes[a] && (millis() - last[a] < interval)) { early++; }
+				last[a] = millis();
+				writes[a]++;
+			}
+			SimRadio::answer(frame);
+		}
+};
+
+static WearRadio sim;
+static FT817 radio;
+
+// the bytes the governor counts less than the radio wrote them; one out of
+// the slots can't be told when they are all in use
+static unsigned long miscounted(FT817Wear *wear)
+{
+	bool full = true;
+	for (const FT817WearSlot &s : wear->stats.slot) { full &= s.address != FT817_WEAR_FREE; }
+
+	unsigned long n = 0;
+	for (unsigned int a = 0; a < SIM_EEPROM_SIZE; a++)
+	{
+		bool in = false;
+		for (const FT817WearSlot &s : wear->stats.slot) { in |= s.address == a; }
+		if ((in || !full) && (wear->count(a) < sim.writes[a])) { n++; }
+	}
+
+	return n;
+}
+
+struct Case
+{
+	const char *name;
+	uint32_t every;			// ms between presses
+	uint32_t bounce;		// ms of a second press after each one, 0 = none
+	bool nar;				// toggle the narrow (per VFO) or the keyer
+	byte bands;				// the narrow of this many bands in turn, 0 = the one in use
+};
+
+// the bit of a band (VFO A) or of the keyer
+static bool bit(const Case &c, byte band)
+{
+	if (!c.nar) { return bitRead(sim.eeprom[0x58], 4); }
+	return bitRead(sim.eeprom[(c.bands ? 0x7D + band * 26 : sim.vfoAddr(sim.vfo())) + 1], 4);
+}
+
+static bool toggle(const Case &c)
+{
+	return c.nar ? radio.toggleNar() : radio.toggleKeyer();
+}
+
+// wait for the virtual clock to get to t, flushing what's due meanwhile
+static void waitUntil(uint32_t t)
+{
+	while ((int32_t)(t - millis()) > 0)
+	{
+		radio.flushEEPROM();
+		if ((int32_t)(t - millis()) > 0) { host::clockAdvance(t - millis() < 100 ? t - millis() : 100); }
+	}
+}
+
+static int run(const Case &c, FT817Wear *wear)
+{
+	host::clockVirtual();
+	sim.reset();
+	sim.clear();
+	if (wear) { sim.interval = wear->interval; }
+	radio.setWear(wear);
+
+	byte bands = c.bands ? c.bands : 1;
+	bool before[SimRadio::bandCount];
+	unsigned long done[SimRadio::bandCount];
+	for (byte b = 0; b < bands; b++)
+	{
+		before[b] = bit(c, b);
+		done[b] = 0;
+	}
+
+	unsigned long w0 = sim.eepromWrites;
+	unsigned long presses = 0;
+	for (uint32_t t = 0; t < 60000; t += c.every)
+	{
+		waitUntil(t);
+		byte b = presses % bands;
+		if (c.bands) { radio.setFreq(SimRadio::bands[b].first / 10 + 1000); }
+		done[b] += toggle(c);
+		presses++;
+		if (c.bounce)
+		{
+			waitUntil(t + c.bounce);
+			done[b] += toggle(c);
+			presses++;
+		}
+	}
+	uint32_t busy = millis();
+
+	// the held ones
+	while (radio.flushEEPROM()) { host::clockAdvance(100); }
+	uint32_t end = millis();
+
+	bool ok = !wear || (!sim.early && !miscounted(wear));
+	for (byte b = 0; b < bands; b++) { ok &= bit(c, b) == (before[b] ^ (done[b] & 1)); }
+	printf("%-7s %-4s %8lu %8lu %6lu %9.1f %9.1f %6lu %7lu %8lu  %s\n", c.name, wear ? "on" : "off", presses,
+		sim.eepromWrites - w0, sim.early, busy / 1000.0, end / 1000.0, wear ? wear->stats.held : 0,
+		wear ? wear->stats.merged : 0, wear ? wear->stats.refused : 0, ok ? "ok" : "WRONG");
+
+	radio.setWear(NULL);
+	return ok ? 0 : 1;
+}
+
+int main(int argc, char **argv)
+{
+	Serial.attach(&sim);
+	radio.begin(9600);
+
+	const Case cases[] = {
+		{"stuck", 100, 0, false, 0},
+		{"bounce", 2000, 50, true, 0},
+		{"sweep", 300, 0, true, SimRadio::bandCount},
+	};
+
+	int failures = 0;
+	printf("%-7s %-4s %8s %8s %6s %9s %9s %6s %7s %8s\n", "case", "gov", "toggles", "writes", "early", "done s",
+		"flushed s", "held", "merged", "refused");
+	for (const Case &c : cases)
+	{
+		failures += run(c, NULL);
+
+		FT817Wear wear;
+		if (argc > 1) { wear.interval = atoi(argv[1]); }
+		failures += run(c, &wear);
+		const FT817WearSlot *top = &wear.stats.slot[0];
+		for (const FT817WearSlot &s : wear.stats.slot)
+		{
+			if ((s.count > top->count) || ((s.count == top->count) && (s.address < top->address))) { top = &s; }
+		}
+		printf("%-12s most written 0x%03X, %lu writes (0x%03X after it %lu)\n", "", top->address, top->count,
+			top->address + 1, wear.count(top->address + 1));
+	}
+
+	return failures ? 1 : 0;
+}
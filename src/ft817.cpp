@@ -16,16 +16,16 @@ Library author is Pavel Milanes
 
 IMPORTANT STUFF
 ================
-As communications are uni-directional we use the variable "buffer"
-to send and receive data to and from the radio, whether we send or
-receive it always be to and from the buffer.
-
-This allow us to be consistent and save a few bytes of firmware
+There is no shared buffer: every frame is built by the static frameXYZ()
+encoders into the caller's own 5 bytes and sent with sendFrame(), the
+answers are read into the caller's storage by readReply()/transact() and
+decoded in place (replyFreq()). See "Frame API" in the README.
 
 */
 #define Use_HW_Serial
 
 #include <Arduino.h>
+#include "ft817uart.h"		// before the port choice, it defines FT817_UART_ACTIVE
 #ifndef Use_HW_Serial
 	#include <SoftwareSerial.h>
 	// define software serial IO pins here:
@@ -35,7 +35,11 @@ This allow us to be consistent and save a few bytes of firmware
         extern SoftwareSerial rigCat(12, 11); // rx,tx
     #endif
 #else
-	#define rigCat Serial
+	#ifdef FT817_UART_ACTIVE
+		#define rigCat ft817Uart	// interrupt driven, see ft817uart.h
+	#else
+		#define rigCat Serial
+	#endif
 #endif
 
 #include "ft817.h"
@@ -60,7 +64,29 @@ void FT817::begin(unsigned int baud)
 	rigCat.begin(baud, SERIAL_8N2);
 }
 
+// attach a traffic tap, all frames sent and bytes received will be
+// reported to it; pass NULL to detach it
+void FT817::setTap(FT817Tap *t)
+{
+	tap = t;
+}
+
+#if FT817_WITH_EEPROM
+// attach a EEPROM wear governor, NULL to detach it
+void FT817::setWear(FT817Wear *w)
+{
+	wear = w;
+}
 
+// attach a EEPROM shadow, NULL to detach it
+void FT817::setShadow(FT817Shadow *s)
+{
+	shadow = s;
+}
+#endif
+
+
+#if FT817_WITH_SET
 /****** TOGGLE COMMANDS ********/
 
 // lock or unlock the radio
@@ -120,75 +146,71 @@ void FT817::toggleVFO()
 {
 	singleCmd(CAT_VFO_AB);
 	// mandatory delay to wait for the radio to apply the changes
-	delay(200);
+	delay(FT817Traits::vfoSettle);
 }
+#endif
 
+#if FT817_WITH_EEPROM
 // Toggle the narrow value for the actual VFO
 // with a fast switch of the VFO to apply
-// NAR is bit 4 in byte base address + 1
 bool FT817::toggleNar()
 {
-	return toggleBitFromVFO(1, 4);
+	return toggle<FT817_FIELD_NAR>();
 }
 
 // Toggle the IPO value for the actual VFO
 // with a fast switch of the VFO to apply
-// NAR is bit 5 in byte base address + 2
 bool FT817::toggleIPO()
 {
-	return toggleBitFromVFO(2, 5);
+	return toggle<FT817_FIELD_IPO>();
 }
 
 // Toggle the BreakIn option
-// BreakIn is bit 5 of EEPROM byte 58
 bool FT817::toggleBreakIn()
 {
-	MSB = 0x00;
-	LSB = 0x58;
-	return toggleBitFromEEPROM(5);
+	return toggle<FT817_FIELD_BREAKIN>();
 }
 
 // Toggle the Keyer status
-// Keyer is bit 4 of EEPROM byte 58
 bool FT817::toggleKeyer()
 {
-	MSB = 0x00;
-	LSB = 0x58;
-	return toggleBitFromEEPROM(4);
+	return toggle<FT817_FIELD_KEYER>();
 }
 
 // Toggle the RF Gain / Squelch control
-// Set by bit 7 of EEPROM byte 5F
 bool FT817::toggleRfSql()
 {
-	MSB = 0x00;
-	LSB = 0x5F;
-	return toggleBitFromEEPROM(7);
+	return toggle<FT817_FIELD_RFSQL>();
 }
+#endif
 
+#if FT817_WITH_SET
 /****** SET COMMANDS ********/
 
 // set radio frequency directly (as a long integer)
 // in 10hz steps
 void FT817::setFreq(unsigned long freq)
 {
-	to_bcd_be(freq);
-	buffer[4] = CAT_FREQ_SET;
-	sendCmd();
+	byte frame[5];
+	frameFreq(frame, freq, CAT_FREQ_SET);
+	sendFrame(frame);
 	getByte();
+
+	// now we know it
+	this->freq = freq;
+#if FT817_WITH_EEPROM
+	freqValid = true;
+	freqAt = millis();
+#endif
 }
 
 // set radiomode using define values
 void FT817::setMode(byte mode)
 {
 	// check for valid modes
-	if ((mode < 0x05) | (mode == 0x06) | (mode == 0x08) | (mode == 0x0A) | (mode == 0x0C))
+	if (ft817ValidCmd(CAT_MODE_SET, mode))
 	{
-		flushBuffer();
-		buffer[0] = mode;
-		buffer[4] = CAT_MODE_SET;
-		sendCmd();
-		getByte();     
+		singleCmd(CAT_MODE_SET, mode);
 	}
 }
 
@@ -198,109 +220,143 @@ void FT817::clarFreq(unsigned long freq)
 	// will come back to this later
 }
 
-// switch to a specific VFO
-void FT817::switchVFO(bool vfo)
+// set up a split: RX freq (& mode) in a VFO, TX in the other and split on
+// instead of checking the VFO and going to the other and back, the TX
+// goes in the current VFO, then the swap and the RX goes in the new one,
+// so a single swap; the frames before & after it go through pipeline(),
+// ack by ack unless the model takes them back to back
+// an invalid mode (FT817_MODE_KEEP) leaves the mode as is
+// returns true if the radio acked all the frames
+bool FT817::setSplit(unsigned long rxFreq, unsigned long txFreq, byte rxMode, byte txMode)
 {
-	if (getVFO() != vfo) {
-		toggleVFO();
+	byte frames[3][5];
+	byte n = 0;
+
+	// TX
+	frameFreq(frames[n++], txFreq, CAT_FREQ_SET);
+	if (ft817ValidCmd(CAT_MODE_SET, txMode)) { frameCmd(frames[n++], CAT_MODE_SET, txMode); }
+	frameCmd(frames[n++], CAT_VFO_AB);
+	bool done = pipeline(frames[0], n) == n;
+
+	// mandatory delay to wait for the radio to apply the swap
+	delay(FT817Traits::vfoSettle);
+
+	// RX & split
+	n = 0;
+	frameFreq(frames[n++], rxFreq, CAT_FREQ_SET);
+	if (ft817ValidCmd(CAT_MODE_SET, rxMode)) { frameCmd(frames[n++], CAT_MODE_SET, rxMode); }
+	frameCmd(frames[n++], CAT_SPLIT_ON);
+	done &= pipeline(frames[0], n) == n;
+
+	// we know the freq now
+	if (done)
+	{
+		freq = rxFreq;
+#if FT817_WITH_EEPROM
+		freqValid = true;
+		freqAt = millis();
+#endif
 	}
+
+	return done;
 }
 
 // control repeater offset direction
-void FT817::rptrOffset(char * ofst)
+void FT817::rptrOffset(FT817Offset offset)
 {
-	flushBuffer();
-	buffer[0] = CAT_RPTR_OFFSET_S;	  // default to simplex
-	buffer[4] = CAT_RPTR_OFFSET_CMD;  // command byte
-
-	if (strcmp(ofst, "-") == 0)
-		buffer[0] = CAT_RPTR_OFFSET_N;
-	if (strcmp(ofst, "+") == 0)
-		buffer[0] = CAT_RPTR_OFFSET_P;
-	if (strcmp(ofst, "s") == 0)
-		buffer[0] = CAT_RPTR_OFFSET_S;
-
-	sendCmd();
-	getByte();
+	singleCmd(CAT_RPTR_OFFSET_CMD, offset);
 }
 
 // set the freq of the offset
 void FT817::rptrOffsetFreq(unsigned long freq)
 {
+	byte frame[5];
 	freq = (freq * 100); // convert the incoming value to kHz
-	to_bcd_be(freq);
-	buffer[4] = CAT_RPTR_FREQ_SET; // command byte
-	sendCmd();
+	frameFreq(frame, freq, CAT_RPTR_FREQ_SET);
+	sendFrame(frame);
 	getByte();
 }
 
 // enable or disable various CTCSS and DCS squelch options
-void FT817::squelch(char * mode)
+void FT817::squelch(FT817Squelch mode)
+{
+	singleCmd(CAT_SQL_CMD, mode);
+}
+
+// set the CTCSS tone / DCS code
+void FT817::squelchFreq(unsigned int freq, FT817Tone type)
 {
-	flushBuffer();
-	buffer[0] = CAT_MODE_USB; // default to USB mode
-	buffer[4] = CAT_SQL_CMD;  // command byte
-
-	if (strcasecmp(mode,"DCS")==0)
-		buffer[0] = CAT_SQL_DCS;
-	if (strcasecmp(mode,"DDC")==0)
-		buffer[0] = CAT_SQL_DCS_DECD;
-	if (strcasecmp(mode,"DEN")==0)
-		buffer[0] = CAT_SQL_DCS_ENCD;
-	if (strcasecmp(mode,"TSQ")==0)
-		buffer[0] = CAT_SQL_CTCSS;
-	if (strcasecmp(mode,"TDC")==0)
-		buffer[0] = CAT_SQL_CTCSS_DECD;
-	if (strcasecmp(mode,"TEN")==0)
-		buffer[0] = CAT_SQL_CTCSS_ENCD;
-	if (strcasecmp(mode,"OFF")==0)
-		buffer[0] = CAT_SQL_OFF;
-
-	sendCmd();
+	byte frame[5];
+	frameFreq(frame, freq, type);
+	sendFrame(frame);
 	getByte();
 }
 
-void FT817::squelchFreq(unsigned int freq, char * sqlType)
+#endif
+
+#if FT817_WITH_STRINGS
+// the string versions, the names are in flash
+
+// same, from a string
+void FT817::rptrOffset(char * ofst)
 {
-	to_bcd_be((long)freq);
+	FT817Offset offset = FT817_OFFSET_SIMPLEX;	  // default to simplex
 
-	if (strcasecmp(sqlType, "C") == 0)
-		buffer[4] = CAT_SQL_CTCSS_SET;
-	if (strcasecmp(sqlType, "D") == 0)
-		buffer[4] = CAT_SQL_DCS_SET;
+	if (strcmp_P(ofst, PSTR("-")) == 0)
+		offset = FT817_OFFSET_MINUS;
+	if (strcmp_P(ofst, PSTR("+")) == 0)
+		offset = FT817_OFFSET_PLUS;
 
-	sendCmd();
-	getByte();
+	rptrOffset(offset);
 }
 
-void FT817::setKeyerSpeed(int speed)
+// same, from a string; an unknown one sends nothing
+void FT817::squelch(char * mode)
 {
-	byte wpm = constrain(speed, 4, 60);   	// Constrain input between FT-817 min and max keyer speed
-	byte keyerSpeedSetting = wpm - 4;
-	MSB = 0x00;
-	LSB = 0x62;
-	readEEPROM();
-	if (eepromValidData)
+	static const char names[][4] PROGMEM = {"DCS", "DDC", "DEN", "TSQ", "TDC", "TEN", "OFF"};
+	static const byte modes[] PROGMEM = {FT817_SQL_DCS, FT817_SQL_DCS_DECODE, FT817_SQL_DCS_ENCODE,
+		FT817_SQL_CTCSS, FT817_SQL_CTCSS_DECODE, FT817_SQL_CTCSS_ENCODE, FT817_SQL_OFF};
+
+	for (byte i = 0; i < sizeof(modes); i++)
 	{
-		byte bitsAbove = 0b11000000 & actualByte;	// bits 6 and 7 from byte 0x62 must be kept (= Battery Charge Time)
-		keyerSpeedSetting = bitsAbove | keyerSpeedSetting;
-		writeEEPROM(keyerSpeedSetting);
+		if (strcasecmp_P(mode, names[i]) == 0)
+		{
+			squelch((FT817Squelch)pgm_read_byte(&modes[i]));
+			return;
+		}
 	}
 }
 
+// same, from a string; an unknown one sends nothing
+void FT817::squelchFreq(unsigned int freq, char * sqlType)
+{
+	if (strcasecmp_P(sqlType, PSTR("C")) == 0)
+		squelchFreq(freq, FT817_TONE_CTCSS);
+	if (strcasecmp_P(sqlType, PSTR("D")) == 0)
+		squelchFreq(freq, FT817_TONE_DCS);
+}
+#endif
 
-/****** GET COMMANDS ********/
+#if FT817_WITH_EEPROM
+// switch to a specific VFO, the actual one from the radio (not the shadow)
+void FT817::switchVFO(bool vfo)
+{
+	byte data[2];
+	readEEPROM(FT817_FIELD_VFO::address, data);
+	if (FT817_FIELD_VFO::decode(data[0]) != vfo) {
+		toggleVFO();
+	}
+}
 
-// get the actual vfo from the eeprom
-// 0 = A / 1 = B
-// only valid if eepromDataValid is true
-bool FT817::getVFO()
+void FT817::setKeyerSpeed(int speed)
 {
-	MSB = 0x00;	// set the address to read
-	LSB = 0x55;
-	readEEPROM();
-	return (bool)(actualByte & 0b00000001);    // 0 = VFO A, 1 = VFO B
+	byte wpm = constrain(speed, 4, 60);   	// Constrain input between FT-817 min and max keyer speed
+	set<FT817_FIELD_KEYER_SPEED>(wpm - 4);	// the battery charge time in the same byte is kept
 }
+#endif
+
+
+/****** GET COMMANDS ********/
 
 // get the mode indirectly
 byte FT817::getMode()
@@ -313,46 +369,26 @@ byte FT817::getMode()
 // if called as getFreqMode() return only the frequency
 unsigned long FT817::getFreqMode()
 {
-	flushBuffer();
-	buffer[4] = CAT_RX_FREQ_CMD;
-
-	rigCat.flush();
-	sendCmd();
-	getBytes(5);
+	byte frame[5];
+	byte reply[5];
+	frameCmd(frame, CAT_RX_FREQ_CMD);
+#if FT817_WITH_EEPROM
+	freqValid = transact(frame, reply, 5) == 5;
+	freqAt = millis();
+#else
+	transact(frame, reply, 5);
+#endif
 
-	freq = from_bcd_be();
-	mode = buffer[4];
+	freq = replyFreq(reply);
+	mode = reply[4];
 
 	return freq;
 }
 
-// get the bands for the specified VFO
-byte FT817::getBandVFO(bool vfo)
-{
-	// see the band specs in the .h file
-	MSB = 0x00;	// set the address to read
-	LSB = 0x59;
-	readEEPROM();
-	byte band = actualByte;
-	if (vfo)
-	{
-		// B
-		return band >> 4;
-	}
-	else
-	{
-		// A
-		return band & 0b00001111;
-	}
-}
 // get powermeter value
 byte FT817::getPMeter()
 {
-	flushBuffer();
-	buffer[4] = CAT_TX_DATA_CMD;
-
-	sendCmd();
-	byte reply = getByte();
+	byte reply = singleCmd(CAT_TX_DATA_CMD);
 	//
 	if (((reply>>7)&0x1) == 1) { // in RX state
 		return 0;
@@ -367,11 +403,7 @@ byte FT817::getPMeter()
 // if Bit 7 is 0 than radio is in TX state
 bool FT817::chkTX()
 {
-	flushBuffer();
-	buffer[4] = CAT_TX_DATA_CMD;
-
-	sendCmd();
-	byte reply = getByte();
+	byte reply = singleCmd(CAT_TX_DATA_CMD);
 
 	if (((reply>>7)&0x1) == 0) {
 		return true; // In TX state
@@ -379,191 +411,628 @@ bool FT817::chkTX()
 		return false; // In RX state
 	}
 }
-// get display selection
-// values from 0x00 to 0x0B
+// get smeter value
+byte FT817::getSMeter()
+{
+	return singleCmd(CAT_RX_DATA_CMD) & 0b00001111;
+}
+
+#if FT817_WITH_EEPROM
+// get the actual vfo from the eeprom
+// 0 = A / 1 = B
 // only valid if eepromDataValid is true
-byte FT817::getDisplaySelection()
+bool FT817::getVFO()
 {
-	MSB = 0x00;	// set the address to read
-	LSB = 0x76;
-	readEEPROM();
-	return actualByte & 0b00001111;    // display selection is bits 0-3 of hex address 0x76
+	byte data[2];
+	if (!shadowRead(FT817_FIELD_VFO::address, false, data)) { readEEPROM(FT817_FIELD_VFO::address, data); }
+	return FT817_FIELD_VFO::decode(data[0]);	// 0 = VFO A, 1 = VFO B
 }
 
-// get smeter value
-byte FT817::getSMeter()
+// get the bands for the specified VFO
+byte FT817::getBandVFO(bool vfo)
 {
-	flushBuffer();
-	buffer[4] = CAT_RX_DATA_CMD;
-	sendCmd();
-	return getByte() & 0b00001111;
+	// see the band specs in the .h file
+	byte data[2];
+	if (!shadowRead(FT817_FIELD_BAND_A::address, false, data)) { readEEPROM(FT817_FIELD_BAND_A::address, data); }
+	if (vfo)
+	{
+		return FT817_FIELD_BAND_B::decode(data[0]);
+	}
+	else
+	{
+		return FT817_FIELD_BAND_A::decode(data[0]);
+	}
+}
+
+// get display selection
+// values from 0x00 to 0x0B
+// only valid if eepromDataValid is true
+byte FT817::getDisplaySelection()
+{
+	byte data[2];
+	if (!shadowRead(FT817_FIELD_DISPLAY::address, false, data)) { readEEPROM(FT817_FIELD_DISPLAY::address, data); }
+	return FT817_FIELD_DISPLAY::decode(data[0]);
 }
 
 // get narrow state for the actual VFO
-// NAR is bit 4 in byte base address + 1
 bool FT817::getNar()
 {
-	return getBitFromVFO(1, 4);
+	return get<FT817_FIELD_NAR>();
 }
 
 // get IPO state for the actual VFO
-// IPO is bit 5 in byte base address + 2
 bool FT817::getIPO()
 {
-	return getBitFromVFO(2, 5);
+	return get<FT817_FIELD_IPO>();
 }
 
-// get BreakIn status from bit 5 in EEPROM address 0x58
+// get BreakIn status
 bool FT817::getBreakIn()
 {
-	MSB = 0x00;
-	LSB = 0x58;
-	return getBitFromEEPROM(5);
+	return get<FT817_FIELD_BREAKIN>();
 }
 
-// get Keyer status from bit 4 in EEPROM address 0x58
+// get Keyer status
 bool FT817::getKeyer()
 {
-	MSB = 0x00;
-	LSB = 0x58;
-	return getBitFromEEPROM(4);
+	return get<FT817_FIELD_KEYER>();
 }
 
+// get the whole status at once, the calls above one by one read the same
+// bytes (0x55, 0x58, 0x59) over and over, here each byte is read once and
+// every 0xBB read gives two of them:
+//	0x55 (VFO), 0x58+0x59 (break-in, keyer, bands), 0x76 (display) and then
+//	base+1 & base+2 of the current VFO (narrow, IPO)
+// that's 4 EEPROM reads plus the freq/mode, RX and TX status frames
+bool FT817::getState(FT817State *state)
+{
+	byte frame[5];
+	byte reply[5];
+
+	// CAT
+	frameCmd(frame, CAT_RX_FREQ_CMD);
+	freqValid = transact(frame, reply, 5) == 5;
+	freqAt = millis();
+	freq = replyFreq(reply);
+	mode = reply[4];
+	state->freq = freq;
+	state->mode = mode;
+
+	state->smeter = singleCmd(CAT_RX_DATA_CMD) & 0b00001111;
+
+	// the TX status gives the PTT and the power meter in one byte
+	byte tx = singleCmd(CAT_TX_DATA_CMD);
+	state->tx = !bitRead(tx, 7);
+	state->pmeter = 0;
+	if (state->tx)
+	{
+		state->pmeter = (tx & 0b00001111) | (bitRead(tx, 6) ? 0b10000000 : 0);
+	}
 
-/****** AUX PRIVATE  ********/
+	// EEPROM, the ones that do not depend on the VFO (sorted)
+	const unsigned int address[] = {
+		FT817_FIELD_VFO::address,
+		FT817_FIELD_KEYER::address,		// break-in is in the same byte
+		FT817_FIELD_BAND_A::address,	// band B too
+		FT817_FIELD_DISPLAY::address};
+	byte data[4];
+	if (!readEEPROMSet(address, data, 4)) { return false; }
+
+	state->vfo = FT817_FIELD_VFO::decode(data[0]);
+	state->breakIn = FT817_FIELD_BREAKIN::decode(data[1]);
+	state->keyer = FT817_FIELD_KEYER::decode(data[1]);
+	state->bandA = FT817_FIELD_BAND_A::decode(data[2]);
+	state->bandB = FT817_FIELD_BAND_B::decode(data[2]);
+	state->display = FT817_FIELD_DISPLAY::decode(data[3]);
+
+	// the current VFO ones, from what we already know
+	unsigned int base = ft817VFOBase(state->vfo, state->vfo ? state->bandB : state->bandA);
+	const unsigned int vfoAddress[] = {base + FT817_FIELD_NAR::address, base + FT817_FIELD_IPO::address};
+	if (!readEEPROMSet(vfoAddress, data, 2)) { return false; }
+
+	state->nar = FT817_FIELD_NAR::decode(data[0]);
+	state->ipo = FT817_FIELD_IPO::decode(data[1]);
 
-// gets a byte of input data from the radio
-byte FT817::getByte()
+	return true;
+}
+
+
+/****** SETTINGS ********/
+
+// read all the menu & configuration area, two bytes per read
+bool FT817::readSettings(FT817Settings *settings)
 {
-	unsigned long startTime = millis();
-	while (rigCat.available() < 1 && millis() < startTime + 2000) { ; }  // I see this came from the VE3BUX lib... but shouldn't something be inside this while{} ? Maybe a timeout?
-	return rigCat.read();
+	if (shadow && shadow->live)
+	{
+		*settings = shadow->data.settings;
+		return eepromValidData = true;
+	}
+
+	return readEEPROMRange(FT817_SETTINGS_START, settings->data, FT817_SETTINGS_SIZE);
 }
 
-// gets x bytes of input data from the radio
-// and load it on the buffer MSBF
-void FT817::getBytes(byte count)
+// write back the settings, only the bytes that are different from what the
+// radio has now, each write frame takes two bytes so a changed byte is
+// written with the next one (its new value or what's already there); all
+// written bytes are verified at the end with a single read pass. With a
+// wear governor each changed byte goes through it, the next one of a frame
+// too: the held ones are written later by flushEEPROM() (a held next one
+// goes in the frame as it is now) and if one is refused it returns false
+bool FT817::writeSettings(const FT817Settings *settings)
 {
-	unsigned long startTime = millis();
-	while (rigCat.available() < 1 && millis() < startTime + 2000) { ; }
+	// what is in the radio now, plus the byte after the area
+	byte actual[FT817_SETTINGS_SIZE + 1];
+	if (!readEEPROMRange(FT817_SETTINGS_START, actual, FT817_SETTINGS_SIZE + 1)) { return false; }
 
-	flushBuffer();
-	for (byte i=0; i<count; i++)
+	// what we want: the settings, with the radio state bits as they are
+	byte want[FT817_SETTINGS_SIZE + 1];
+	for (byte i=0; i<FT817_SETTINGS_SIZE; i++)
 	{
-		buffer[i] = rigCat.read();
-		delay(5);					// needs a delay in here, otherwise the byte sequence read is incorrect
+		byte state = ft817StateBits(FT817_SETTINGS_START + i);
+		want[i] = (settings->data[i] & ~state) | (actual[i] & state);
 	}
+	want[FT817_SETTINGS_SIZE] = actual[FT817_SETTINGS_SIZE];
+
+	// write the changes, in pairs
+	byte frame[5];
+	bool written = false;
+	bool refused = false;
+	for (byte i=0; i<FT817_SETTINGS_SIZE; i++)
+	{
+		if (want[i] == actual[i]) { continue; }
+
+		// the whole byte, as (old & 0) ^ new; one not written now is left
+		// out of the verify pass too, the next one is written as it is
+		if (wear)
+		{
+			byte mask = 0;
+			byte bits = want[i];
+			byte verdict = wear->request(FT817_SETTINGS_START + i, false, &mask, &bits);
+			if (verdict != FT817_WEAR_NOW)
+			{
+				refused |= verdict == FT817_WEAR_REFUSED;
+				want[i] = actual[i];
+				continue;
+			}
+
+			if (want[i + 1] != actual[i + 1])
+			{
+				mask = 0;
+				bits = want[i + 1];
+				verdict = wear->request(FT817_SETTINGS_START + i + 1, false, &mask, &bits);
+				if (verdict != FT817_WEAR_NOW)
+				{
+					refused |= verdict == FT817_WEAR_REFUSED;
+					want[i + 1] = actual[i + 1];
+				}
+			}
+		}
+
+		frameWriteEEPROM(frame, FT817_SETTINGS_START + i, want[i], want[i + 1]);
+		sendFrame(frame);
+		getByte();
+		delay(FT817Traits::eepromWrite);	// EEPROM write delay, see writeEEPROM()
+
+		written = true;
+		i++;	// the next one is done
+	}
+
+	eepromValidData = true;
+	if (!written) { return !refused; }
+
+	// verify the written pairs
+	byte pair[2];
+	for (byte i=0; i<FT817_SETTINGS_SIZE; i++)
+	{
+		if (want[i] == actual[i]) { continue; }
+
+		if (!readEEPROMRetry(FT817_SETTINGS_START + i, pair)) { return false; }
+		if ((pair[0] != want[i]) || (pair[1] != want[i + 1])) { return false; }
+
+		i++;
+	}
+
+	return !refused;
+}
+#endif
+
+
+/****** FRAME API ********/
+
+// load a command frame: {p1,0x00,0x00,0x00,cmd}
+void FT817::frameCmd(byte *frame, byte cmd, byte p1)
+{
+	frame[0] = p1;
+	frame[1] = 0;
+	frame[2] = 0;
+	frame[3] = 0;
+	frame[4] = cmd;
+}
+
+// load a frequency (in 10hz resolution) as BCD in the first
+// four bytes of the frame, then the command byte
+void FT817::frameFreq(byte *frame, unsigned long f, byte cmd)
+{
+	ft817EncodeFreq(f, frame);	// no divisions, see ft817codec.h
+	frame[4] = cmd;
+}
+
+#if FT817_WITH_EEPROM
+// load an EEPROM read frame for the address
+void FT817::frameReadEEPROM(byte *frame, unsigned int address)
+{
+	frame[0] = (byte)(address >> 8);	// MSB EEPROM data byte
+	frame[1] = (byte)(address & 0xFF);	// LSB EEPROM data byte
+	frame[2] = 0;
+	frame[3] = 0;
+	frame[4] = 0xBB;	// BB command byte (read EEPROM data)
+}
+
+// load an EEPROM write frame, it always writes two bytes: the
+// one at the address and the next one
+void FT817::frameWriteEEPROM(byte *frame, unsigned int address, byte data, byte next)
+{
+	frame[0] = (byte)(address >> 8);
+	frame[1] = (byte)(address & 0xFF);
+	frame[2] = data;
+	frame[3] = next;
+	frame[4] = 0xBC;	// EEPROM WRITE (JUST ONE TIME)
+}
+#endif
+
+// decode the frequency in a freq/mode reply, in 10hz resolution
+unsigned long FT817::replyFreq(const byte *reply)
+{
+	// first four bytes from buffer are the freq data in binary coded decimal
+	// {0x01,0x40,0x07,0x00,0x01} tunes to 14.070MHz
+	return ft817DecodeFreq(reply);
 }
 
 // this is the function which actually does
 // the serial transaction to the radio
-// it ALWAYS send the 5 bytes in the buffer
-void FT817::sendCmd()
+// it ALWAYS send the 5 bytes in the frame
+void FT817::sendFrame(const byte *frame)
+{
+	flushRX();
+	writeFrame(frame);
+}
+
+#if FT817_WITH_SET
+// send count frames and collect their acks; by default one by one, each
+// after the ack of the one before as singleCmd() does. Only a model that
+// takes them back to back (FT817Traits::pipeline, see ft817model.h) gets
+// them all at once with the acks read after, saving a round trip per frame
+// returns the count of acks received
+byte FT817::pipeline(const byte *frames, byte count)
+{
+	byte acks = 0;
+	if (!FT817Traits::pipeline)
+	{
+		for (byte i=0; i<count; i++)
+		{
+			sendFrame(frames + i * 5);
+			if (getByte() != 0xFF) { acks++; }	// 0xFF is a timeout
+		}
+
+		return acks;
+	}
+
+	flushRX();
+	for (byte i=0; i<count; i++)
+	{
+		writeFrame(frames + i * 5);
+	}
+
+	for (byte i=0; i<count; i++)
+	{
+		if (getByte() != 0xFF) { acks++; }
+	}
+
+	return acks;
+}
+#endif
+
+// write the frame, with no RX flush
+void FT817::writeFrame(const byte *frame)
 {
 	for (byte i=0; i<5; i++)
 	{
-		rigCat.write(buffer[i]);
+		rigCat.write(frame[i]);
+	}
+
+	if (tap) { tap->tx(frame); }
+
+#if FT817_WITH_EEPROM
+	// the frequency we know is gone with a new one or the other VFO, even
+	// if the frame was built outside (FT817Tuner)
+	if ((frame[4] == CAT_FREQ_SET) | (frame[4] == CAT_VFO_AB)) { freqValid = false; }
+
+	// the swap changes the VFO in the EEPROM too; a shadow that is not
+	// live is left as loaded, warmStart() checks it against the radio
+	if (shadow && shadow->live && (frame[4] == CAT_VFO_AB))
+	{
+		byte *vfo = shadow->find(FT817_FIELD_VFO::address);
+		shadow->put(FT817_FIELD_VFO::address, *vfo ^ FT817_FIELD_VFO::mask);
+	}
+
+	// count the EEPROM writes (both bytes of the frame), whoever does them,
+	// and keep the shadow up to date (a write that did not go is fixed by the read that verifies it)
+	if (frame[4] == 0xBC)
+	{
+		unsigned int address = ((unsigned int)frame[0] << 8) | frame[1];
+		if (wear) { wear->wrote(address); }
+		if (shadow && shadow->live)
+		{
+			shadow->put(address, frame[2]);
+			shadow->put(address + 1, frame[3]);
+		}
 	}
+#endif
+}
+
+// gets x bytes of input data from the radio
+// and load it on the reply MSBF, returns the
+// count of bytes really received
+byte FT817::readReply(byte *reply, byte count)
+{
+	unsigned long startTime = millis();
+	while (rigCat.available() < 1 && (uint32_t)(millis() - startTime) < FT817_TIMEOUT) { ; }
+
+	byte received = 0;
+	for (byte i=0; i<count; i++)
+	{
+		int data = rigCat.read();
+		if (data >= 0) { received++; }
+		if (tap)
+		{
+			if (data < 0) { tap->timeout(); } else { tap->rx(data); }
+		}
+		reply[i] = data;
+		// needs a delay in here, otherwise the byte sequence read is incorrect
+		delay(i < count - 1 ? FT817Traits::byteGap : FT817Traits::replyTail);
+	}
+
+	return received;
+}
+
+// check if there are count bytes of answer waiting, to poll for
+// the answer without blocking (readReply() will not wait then)
+bool FT817::replyReady(byte count)
+{
+	return rigCat.available() >= count;
+}
+
+// send the frame and return at once, the answer is collected as it comes;
+// the ISR counts it from before the frame goes out (after the stale bytes
+// are gone), so a fast first byte is not missed
+void FT817::post(const byte *frame)
+{
+	expected = ft817ReplySize(frame[4]);
+	replyComplete = false;
+	flushRX();
+#ifdef FT817_UART_ACTIVE
+	ft817Uart.expect(expected);
+#endif
+	writeFrame(frame);
+	postedAt = millis();
+}
+
+// true when the whole answer of the post()ed frame is in, or it timed
+// out; never waits
+bool FT817::replyDone()
+{
+	if (!replyComplete)
+	{
+#ifdef FT817_UART_ACTIVE
+		replyComplete = ft817Uart.done(&replyAt);
+#else
+		if (rigCat.available() >= expected)
+		{
+			replyComplete = true;
+			replyAt = millis();
+		}
+#endif
+	}
+
+	return replyComplete || (uint32_t)(millis() - postedAt) >= FT817_TIMEOUT;
+}
+
+// get the answer of the post()ed frame, what did not come is 0xFF
+// returns the count received
+byte FT817::takeReply(byte *reply)
+{
+	byte received = 0;
+	for (byte i = 0; i < expected; i++)
+	{
+		int data = rigCat.read();
+		if (data >= 0) { received++; }
+		if (tap)
+		{
+			if (data < 0) { tap->timeout(); } else { tap->rx(data); }
+		}
+		reply[i] = data;
+	}
+
+	return received;
+}
+
+// send the frame and read the answer to it
+byte FT817::transact(const byte *frame, byte *reply, byte count)
+{
+	sendFrame(frame);
+	return readReply(reply, count);
+}
+
+
+/****** AUX PRIVATE  ********/
+
+// gets a byte of input data from the radio
+byte FT817::getByte()
+{
+	// wait up to FT817_TIMEOUT for the byte, the (uint32_t) elapsed time
+	// keeps it right when millis() wraps around (every ~49.7 days)
+	unsigned long startTime = millis();
+	while (rigCat.available() < 1 && (uint32_t)(millis() - startTime) < FT817_TIMEOUT) { ; }
+	int data = rigCat.read();
+	if (tap)
+	{
+		if (data < 0) { tap->timeout(); } else { tap->rx(data); }
+	}
+	return data;
 }
 
 // this function reduces total code-space by allowing for
 // single byte commands to be issued (ie. all the toggles)
-byte FT817::singleCmd(int cmd)
+byte FT817::singleCmd(byte cmd, byte p1)
 {
-	flushBuffer();
-	buffer[4] = cmd;
-	sendCmd();
+	byte frame[5];
+	frameCmd(frame, cmd, p1);
+	sendFrame(frame);
 
 	return getByte();
 }
 
-// flush the rx buffer
+// flush the rx buffer, discarding any byte left from a previous
+// answer (a duplicated or late byte) that will otherwise be taken
+// as the answer of the next command, shifting all that come after
+// note: Serial.flush() only waits for the TX to end, not this
+// the tap sees each one as discarded, they are the ones that tell a
+// faulty link
 void FT817::flushRX()
 {
-	rigCat.flush();
-}
-
-// empty the buffer
-void FT817::flushBuffer()
-{
-	memset(buffer, 0, 5);
+	int data;
+	while ((data = rigCat.read()) >= 0)
+	{
+		if (tap) { tap->discard((byte)data); }
+	}
 }
 
-// read a position in the EEPROM from the MSB & LSB vars
+#if FT817_WITH_EEPROM
+// read a position in the EEPROM, data must have room for two bytes
 // returns true if valid data (same value two times in a row)
 // false if no valid data
-// it loads two bytes, they are placed in actualByte & nextByte
-bool FT817::readEEPROM()
+// it loads two bytes: the one at the address and the next one
+bool FT817::readEEPROM(unsigned int address, byte *data)
 {
-	// set 'valid data' flag to false, we see two consequtive matching reads we set it to true
+	byte frame[5];
+	byte reply[2];
+	frameReadEEPROM(frame, address);
+
+	// a timed out read gives 0xFF bytes, two of them in a row must not pass
+	// as valid data, so only complete reads are compared
 	eepromValidData = false;
-	for (byte i=0; i<4; i++)
-	{
-		flushBuffer();
-		buffer[0] = MSB;  // MSB EEPROM data byte
-		buffer[1] = LSB;  // LSB EEPROM data byte
-		buffer[4] = 0xBB; // BB command byte (read EEPROM data) for sendCmd();
-		sendCmd();
-		getBytes(2);
-		if ((i > 0) & ((actualByte == buffer[0]) & (nextByte == buffer[1])))
+	bool lastFull = false;
+	for (byte i=0; i<FT817_EEPROM_READS; i++)
+	{
+		bool full = (transact(frame, reply, 2) == 2);
+		if (lastFull && full && (data[0] == reply[0]) && (data[1] == reply[1]))
 		{
 			eepromValidData = true;
 			break;
 		}
 		else
 		{
-			actualByte = buffer[0];
-			nextByte = buffer[1];
+			data[0] = reply[0];
+			data[1] = reply[1];
+			lastFull = full;
 		}
 
-		delay(20); // mandatory delay
+		delay(FT817Traits::eepromReread); // mandatory delay
+	}
+
+	// what we know now, if the shadow is live (see writeFrame())
+	if (eepromValidData && shadow && shadow->live)
+	{
+		shadow->put(address, data[0]);
+		shadow->put(address + 1, data[1]);
 	}
 
 	return eepromValidData;
 }
 
-// write to the eeprom, the address is loaded from the MSB/LSB
-// we pass the byte to write and load the nextByte from the last read
-// if all goes well we return true, otherwise false
-bool FT817::writeEEPROM(byte data)
+// read the EEPROM with some insistence, FT817_RETRIES more
+// times if needed
+bool FT817::readEEPROMRetry(unsigned int address, byte *data)
 {
-	// perform a read cycle to load the nextByte, with some insistence..
-	byte count = 3;
-	while (!readEEPROM())
+	byte count = FT817_RETRIES;
+	while (!readEEPROM(address, data))
 	{
 		if (count == 0) { break; }
 		count -= 1;
 	}
 
-	// test
-	if (!eepromValidData) { return eepromValidData; }
+	return eepromValidData;
+}
 
-	// load the data in the buffer, no need to flush it as it will be overwritten
-	buffer[0] = MSB;
-	buffer[1] = LSB;
-	buffer[2] = data;
-	buffer[3] = nextByte;
-	buffer[4] = 0xBC;	// EEPROM WRITE (JUST ONE TIME)
-	sendCmd();
-	getByte();
+// read a set of EEPROM addresses (sorted, ascending) into data, with the
+// fewest reads: each read gives two bytes, so two consecutive addresses
+// cost a single read; returns false at the first one that fails
+bool FT817::readEEPROMSet(const unsigned int *address, byte *data, byte count)
+{
+	byte pair[2];
+	for (byte i=0; i<count; i++)
+	{
+		if (shadowRead(address[i], false, &data[i])) { continue; }
+		if (!readEEPROMRetry(address[i], pair)) { return false; }
+		data[i] = pair[0];
 
-	// almost all EEPROMs have a write delay, from 1 to 5 msecs
-	// we go here for 10 msec, this must be adjusted in practice
-	delay(10);
+		if ((i + 1 < count) && (address[i + 1] == address[i] + 1))
+		{
+			i++;
+			data[i] = pair[1];
+		}
+	}
 
-	// read it & check
-	count = 3;
-	while (!readEEPROM())
+	return true;
+}
+
+// read count consecutive bytes from address, two per read
+bool FT817::readEEPROMRange(unsigned int address, byte *data, byte count)
+{
+	byte pair[2];
+	for (byte i=0; i<count; i+=2)
 	{
-		if (count == 0) { break; }
-		count -= 1;
+		if (!readEEPROMRetry(address + i, pair)) { return false; }
+		data[i] = pair[0];
+		if (i + 1 < count) { data[i + 1] = pair[1]; }
 	}
 
-	// test
-	if (!eepromValidData) { return eepromValidData; }
+	return true;
+}
+
+// write to the eeprom, we pass the byte to write and
+// preserve the next one by reading it first
+// if all goes well we return true, otherwise false
+bool FT817::writeEEPROM(unsigned int address, byte data)
+{
+	byte actual[2];
+
+	// perform a read cycle to load the next byte, with some insistence..
+	if (!readEEPROMRetry(address, actual)) { return eepromValidData; }
+
+	return writeEEPROM(address, data, actual[1]);
+}
+
+// the same, when the next byte is already known (just read)
+bool FT817::writeEEPROM(unsigned int address, byte data, byte next)
+{
+	byte frame[5];
+	byte actual[2];
+
+	// write it
+	frameWriteEEPROM(frame, address, data, next);
+	sendFrame(frame);
+	getByte();
+
+	// almost all EEPROMs have a write delay, from 1 to 5 msecs
+	// we go here for 10 msec (on the FT-817), this must be adjusted in practice
+	delay(FT817Traits::eepromWrite);
+
+	// read it & check
+	if (!readEEPROMRetry(address, actual)) { return eepromValidData; }
 
 	// compare
-	if (actualByte != data)
+	if (actual[0] != data)
 	{
 		return false;
 	}
@@ -573,193 +1042,351 @@ bool FT817::writeEEPROM(byte data)
 	}
 }
 
-// get the bytes in the buffer and return it
-// as a frequency in 10hz resolution
-unsigned long FT817::from_bcd_be()
+// calc the eeprom base address of the actual VFO, returns true/false
+// true is a confirmation of the eeprom readdings confirmed, also
+// eepromValidData has the result also, the target base address will be
+// loaded on address; if it's to write there the band is read from the
+// radio, the band table is not checked on a real radio to trust a write to it
+bool FT817::calcVFOaddr(unsigned int *address, bool write)
 {
-	// first four bytes from buffer are the freq data in binary coded decimal
-	// {0x01,0x40,0x07,0x00,0x01} tunes to 14.070MHz
-	freq = 0;
-	for (byte i = 0; i < 4; i++)
+	// get the current vfo, always from the radio (not the shadow) as this
+	// is the address to write to
+	byte data[2];
+	readEEPROM(FT817_FIELD_VFO::address, data);
+	if (!eepromValidData) { return false; }
+	bool vfo = FT817_FIELD_VFO::decode(data[0]);
+
+	// get the vfo band, from the frequency if we know it from a recent read
+	// or set, saving the read of 0x59
+	byte band = FT817_BAND_NONE;
+	if (!write && freqValid && (uint32_t)(millis() - freqAt) < FT817_FRESH)
+	{
+		band = ft817Band(freq);
+	}
+	if (band == FT817_BAND_NONE)
 	{
-		freq *= 10;
-		freq += buffer[i] >> 4;
-		freq *= 10;
-		freq += buffer[i] & 0x0f;
+		readEEPROM(FT817_FIELD_BAND_A::address, data);
+		if (!eepromValidData) { return false; }
+		band = vfo ? FT817_FIELD_BAND_B::decode(data[0]) : FT817_FIELD_BAND_A::decode(data[0]);
 	}
 
-	return freq;
+	// calc the base address
+	*address = ft817VFOBase(vfo, band);
+
+	// return
+	return true;
 }
 
-// get the frequency in 10hz resolution and load
-// it on the tx buffer 
-void FT817::to_bcd_be(unsigned long f)
+// read the byte at a offset of x bytes from the actual VFO
+// address, the final address is placed on address and the
+// byte read on data (room for two bytes)
+//
+// Must check the eepromValidData to know if it's output is valid
+bool FT817::readFromVFO(signed int offset, unsigned int *address, byte *data)
 {
-	unsigned char a;
+	// try to get the base address to the actual VFO, returns false if we
+	// can't calculate it
+	if (!calcVFOaddrRetry(address)) { return false; }
 
-	// clear the nullpad
-	flushBuffer();
+	// we are targeting base address + offset
+	*address += offset;
 
-	for (int i=3; i>= 0; i--)
-	{
-		a = f % 10;
-		f /= 10;
-		a |= (f % 10) << 4;
-		f /= 10;
-		buffer[i] = a;
-	}
+	// get the final value
+	return readEEPROMRetry(*address, data);
 }
 
-// calc the eeprom base address of the actual VFO, returns true/false
-// true is a confirmation of the eeprom readdings confirmed, also
-// eepromValidData has the result also, the target base address will be 
-// loaded to MSB/LSB
-bool FT817::calcVFOaddr()
+// calcVFOaddr() with some insistence
+bool FT817::calcVFOaddrRetry(unsigned int *address, bool write)
 {
-	// get the current vfo
-	bool vfo = getVFO();
-	if (!eepromValidData) { return false; }
+	byte count = FT817_RETRIES;
+	while (!calcVFOaddr(address, write))
+	{
+		if (count == 0) { break; }
+		count -= 1;
+	}
 
-	// get the vfo band
-	byte band = getBandVFO(vfo);
-	if (!eepromValidData) { return false; }
+	return eepromValidData;
+}
 
-	// calc the base address
-	unsigned int address = 0x7D + ((int)vfo * 390) + (band * 26);
+// read a field: the bits in mask of the byte at address (or at the offset
+// address from the actual VFO base if perVFO), shifted down
+// Must check the eepromValidData to know if it's output is valid
+byte FT817::getField(unsigned int address, bool perVFO, byte shift, byte mask)
+{
+	byte data[2];
+	if (shadowRead(address, perVFO, data))
+	{
+		return (data[0] & mask) >> shift;
+	}
 
-	// load it on the MSB/LSB
-	modAddr(address, 0);
+	if (perVFO)
+	{
+		if (!readFromVFO(address, &address, data)) { return 0; }
+	}
+	else
+	{
+		if (!readEEPROMRetry(address, data)) { return 0; }
+	}
 
-	// return
-	return true;
+	return (data[0] & mask) >> shift;
 }
 
-// Increment the address in MSB/LSB in a safe way
-// you can pass "1" o "-10" safely as an variaton
-// if address = 0 then load the values from MSB/LSB
-// if you pass an address and zero variation it just
-// load the values of address in the MSB/LSB
-void FT817::modAddr(int address, signed int variation)
+// write a field as ((old & keep) | put) ^ flip (put must be in ~keep), if
+// there is a wear governor it may hold it for later or refuse it
+// returns true if success (or held), false otherwise
+bool FT817::updateField(unsigned int address, bool perVFO, byte keep, byte put, byte flip)
 {
-	if (address == 0)
+	// the address of the per VFO ones
+	if (perVFO)
 	{
-		// we need to work with the address in the MSB/LSB
-		address = ((int)MSB << 8) + LSB;
+		unsigned int base;
+		if (!calcVFOaddrRetry(&base, true)) { return false; }
+		address += base;
 	}
 
-	// modify it
-	address += variation;
+	// as (old & mask) ^ bits, the way the governor merges them
+	byte mask = keep;
+	byte bits = put ^ flip;
+	if (wear)
+	{
+		byte verdict = wear->request(address, perVFO, &mask, &bits);
+		if (verdict == FT817_WEAR_HELD) { return true; }
+		if (verdict == FT817_WEAR_REFUSED) { return false; }
+	}
 
-	MSB = (byte)(address >> 8);
-	LSB = (byte)(address & 0xFF);
+	return applyField(address, perVFO, mask, bits);
 }
 
-// Returns the value of a specific bit from an eeprom address
-// Must check the eepromValidData to know if it's output is valid 
-// Address is get from MSB/LSB
-bool FT817::getBitFromEEPROM(byte rbit)
+// write the byte at address as (old & mask) ^ bits, nothing is written if
+// it does not change; the radio only takes the data of the actual VFO when
+// switching to it, so if vfo it's written from the other VFO
+// returns true if success, false otherwise
+bool FT817::applyField(unsigned int address, bool vfo, byte mask, byte bits)
 {
-	// get the final value and return it
-	byte count = 3;
-	while (!readEEPROM())
+	// get the byte, and the next one
+	byte data[2];
+	if (!readEEPROMRetry(address, data)) { return false; }
+
+	byte newData = (data[0] & mask) ^ bits;
+	if (newData == data[0]) { return true; }
+
+	// program it back, but first switch the vfo; the freq is the same when
+	// we are back
+	bool known = freqValid;
+	if (vfo) { toggleVFO(); }
+
+	// write it back, with provisions, the first time with the next
+	// byte we just read
+	bool done = writeEEPROM(address, newData, data[1]);
+	byte count = FT817_RETRIES;
+	while (!done && count > 0)
 	{
-		if (count == 0) { break; }
+		done = writeEEPROM(address, newData);
 		count -= 1;
 	}
 
-	// test
-	if (!eepromValidData) { return eepromValidData; }
+	// switch VFO back to target one no matter if success or not
+	if (vfo)
+	{
+		toggleVFO();
+		freqValid = known;
+	}
 
-	// return
-	return (bool)(bitRead(actualByte, rbit));
+	return done;
 }
 
-// Toggle a specific bit from a eeprom address loaded in MSB/LSB
-bool FT817::toggleBitFromEEPROM(byte rbit)
+// write the held EEPROM writes whose address cooled down (see ft817wear.h)
+// returns true if there are some still held
+bool FT817::flushEEPROM()
 {
-	// get the bit
-	bool targetBit = getBitFromEEPROM(rbit);
+	if (!wear) { return false; }
 
-	// success?
-	if (!eepromValidData) { return eepromValidData; }
+	byte i;
+	while (wear->due(&i))
+	{
+		unsigned int address = wear->stats.slot[i].address;
 
-	// modify the byte with the toggled bit
-	byte newData = bitWrite(actualByte, rbit, !targetBit);
+		// a per VFO one needs the VFO switch only if it's in the data in use
+		// now, the VFO or the band may have changed since
+		bool vfo = false;
+		if (wear->perVFO[i])
+		{
+			unsigned int base;
+			if (!calcVFOaddrRetry(&base, true)) { return true; }
+			vfo = (address >= base) && (address < base + FT817_BAND_SIZE);
+		}
 
-	// write it back, with provisions
-	byte count = 3;
-	while (!writeEEPROM(newData))
-	{
-		if (count == 0) { break; }
-		count -= 1;
+		wear->pending[i] = false;
+		if (!applyField(address, vfo, wear->mask[i], wear->bits[i]))
+		{
+			// hold it again, to retry after a while
+			wear->pending[i] = true;
+			wear->last[i] = millis();
+			wear->recent[i] = true;
+			return true;
+		}
 	}
 
-	// success?
-	if (eepromValidData) { return true; } else { return false; }
+	return wear->waiting() > 0;
 }
 
-// Returns the value of a specific bit counting a offset of x bytes
-// from the actual VFO address
-//
-// Must check the eepromValidData to know if it's output is valid 
-bool FT817::getBitFromVFO(signed int offset, byte rbit)
+
+/****** SHADOW ********/
+
+// the byte at address (an offset from the actual VFO base if perVFO) from
+// the shadow, if it's live and has it; no traffic at all
+bool FT817::shadowRead(unsigned int address, bool perVFO, byte *value)
 {
-	// try to get the base address to the actual VFO
-	byte count = 3;
-	while (!calcVFOaddr())
+	if (!shadow || !shadow->live) { return false; }
+
+	if (perVFO)
 	{
-		if (count == 0) { break; }
-		count -= 1;
+		const FT817Settings &s = shadow->data.settings;
+		bool vfo = s.get<FT817_FIELD_VFO>();
+		address += ft817VFOBase(vfo, vfo ? s.get<FT817_FIELD_BAND_B>() : s.get<FT817_FIELD_BAND_A>());
 	}
 
-	// returns false can't calculate the data
-	if (!eepromValidData) { return eepromValidData; }
+	byte *p = shadow->find(address);
+	if (!p) { return false; }
 
-	// we are targeting base address + offset
-	modAddr(0, offset);
+	*value = *p;
+	eepromValidData = true;
+	return true;
+}
+
+// a single read of the pair at address, true if it's the same as in the
+// shadow: the saved copy is the first of the two matching reads
+bool FT817::shadowSpot(unsigned int address)
+{
+	byte frame[5];
+	byte reply[2];
+	frameReadEEPROM(frame, address);
+	if (transact(frame, reply, 2) != 2) { return false; }
+
+	byte *first = shadow->find(address);
+	byte *next = shadow->find(address + 1);
+	return first && (*first == reply[0]) && (!next || (*next == reply[1]));
+}
+
+// read the VFO bytes of the shadow for a VFO, of the band it's in now (as
+// the shadow says), verified
+bool FT817::shadowVFO(bool vfo)
+{
+	const FT817Settings &s = shadow->data.settings;
+	byte band = vfo ? s.get<FT817_FIELD_BAND_B>() : s.get<FT817_FIELD_BAND_A>();
 
-	// get the final value and return it
-	count = 3;
-	while (!readEEPROM())
+	byte data[2];
+	unsigned int address = ft817VFOBase(vfo, band) + FT817_SHADOW_VFO_AT;
+	if (!readEEPROMRetry(address, data)) { return false; }
+
+	// the ones of the band in use now
+	if (band != shadow->data.band[vfo])
 	{
-		if (count == 0) { break; }
-		count -= 1;
+		shadow->data.band[vfo] = band;
+		shadow->seal();
 	}
+	shadow->put(address, data[0]);
+	shadow->put(address + 1, data[1]);
+	return true;
+}
 
-	// test
-	if (!eepromValidData) { return eepromValidData; }
+// read it all from the radio
+bool FT817::loadShadow()
+{
+	shadow->reset();
+	if (!readEEPROMRange(FT817_SETTINGS_START, shadow->data.settings.data, FT817_SETTINGS_SIZE)) { return false; }
+	shadow->seal();
 
-	// return
-	return (bool)(bitRead(actualByte, rbit));
+	return shadowVFO(0) && shadowVFO(1);
 }
 
-// Toggle a specific bit from a offset in the actual VFO
-// returns true if success, false otherwise
-bool FT817::toggleBitFromVFO(signed int offset, byte rbit)
+// take the saved shadow if it's good and a few spot reads agree with it
+// (see ft817shadow.h), or read it all from the radio
+// returns true if it's live, the reads come from it from now on
+bool FT817::warmStart()
 {
-	// get the bit
-	bool targetBit = getBitFromVFO(offset, rbit);
+	if (!shadow) { return false; }
 
-	// success?
-	if (!eepromValidData) { return eepromValidData; }
+	shadow->live = shadow->warm = false;
+	if (shadow->valid())
+	{
+		bool good = true;
 
-	// budify the byte with the toggled bit
-	byte newData = bitWrite(actualByte, rbit, !targetBit);
+		// some settings, they must be as saved
+		for (byte i = 0; good && (i < FT817_SHADOW_SAMPLES); i++)
+		{
+			good = shadowSpot(shadow->sample());
+		}
 
-	// program it back, but first switch the vfo
-	toggleVFO();
+		// the radio state: the VFO & the bands, taken as they come
+		byte data[2];
+		const unsigned int state[] = {FT817_FIELD_VFO::address, FT817_FIELD_BAND_A::address};
+		for (byte i = 0; good && (i < 2); i++)
+		{
+			if (shadowSpot(state[i])) { continue; }
+
+			good = readEEPROMRetry(state[i], data);
+			if (good)
+			{
+				shadow->put(state[i], data[0]);
+				shadow->put(state[i] + 1, data[1]);
+			}
+		}
 
-	// write it back, with provisions
-	byte count = 3;
-	while (!writeEEPROM(newData))
-	{
-		if (count == 0) { break; }
-		count -= 1;
+		// the VFO bytes, the band may be a new one
+		for (byte v = 0; good && (v < 2); v++)
+		{
+			byte band = v ? shadow->data.settings.get<FT817_FIELD_BAND_B>() :
+				shadow->data.settings.get<FT817_FIELD_BAND_A>();
+			good = ((band == shadow->data.band[v]) &&
+				shadowSpot(ft817VFOBase(v, band) + FT817_SHADOW_VFO_AT)) || shadowVFO(v);
+		}
+
+		shadow->warm = good;
 	}
 
-	// switch VFO back to target one no matter if success or not
-	toggleVFO();
+	shadow->live = shadow->warm || loadShadow();
+
+	// a half read one is not to be saved as good
+	if (!shadow->live) { shadow->data.magic = 0; }
+	return shadow->live;
+}
+
+// read the next pair of the shadow from the radio: every other call one
+// of the radio state (the VFO, the bands, the VFO bytes of the actual VFO)
+// and in between the settings & the VFO bytes of both VFOs in turn
+// returns true if something changed
+bool FT817::refreshShadow()
+{
+	if (!shadow || !shadow->live) { return false; }
 
-	// success?
-	if (eepromValidData) { return true; } else { return false; }
+	bool dirty = shadow->dirty;
+	shadow->dirty = false;
+	byte step = shadow->step;
+	shadow->step = (step + 1) % FT817_SHADOW_STEPS;
+
+	byte data[2];
+	byte item = step / 2;
+	if (!(step & 1))
+	{
+		switch (item % 3)
+		{
+			case 0: readEEPROMRetry(FT817_FIELD_VFO::address, data); break;
+			case 1: readEEPROMRetry(FT817_FIELD_BAND_A::address, data); break;
+			case 2: shadowVFO(shadow->data.settings.get<FT817_FIELD_VFO>()); break;
+		}
+	}
+	else if (item < FT817_SHADOW_PAIRS)
+	{
+		readEEPROMRetry(FT817_SETTINGS_START + item * 2, data);
+	}
+	else
+	{
+		shadowVFO(item - FT817_SHADOW_PAIRS);
+	}
+
+	bool changed = shadow->dirty;
+	shadow->dirty |= dirty;
+	return changed;
 }
+#endif
@@ -285,9 +285,16 @@ getBandVFO(VFO)
 #define CAT_h
 
 #include <Arduino.h>
+#include "ft817config.h"
 #ifndef Use_HW_Serial
 	#include <SoftwareSerial.h>
 #endif
+#include "ft817trace.h"
+#include "ft817eeprom.h"
+#include "ft817codec.h"
+#include "ft817uart.h"
+#include "ft817wear.h"
+#include "ft817shadow.h"
 
 #define CAT_LOCK_ON			0x00
 #define CAT_LOCK_OFF		0x80
@@ -330,6 +337,89 @@ getBandVFO(VFO)
 #define CAT_TX_DATA_CMD		0xF7
 #define CAT_RX_FREQ_CMD		0x03
 #define CAT_NULL_DATA		0x00
+#define FT817_MODE_KEEP		0xFF // not a mode, setSplit() leaves it as is
+
+// typed parameters of the commands, a misspelled one does not compile
+enum FT817Offset : byte					// repeater offset
+{
+	FT817_OFFSET_MINUS = CAT_RPTR_OFFSET_N,
+	FT817_OFFSET_PLUS = CAT_RPTR_OFFSET_P,
+	FT817_OFFSET_SIMPLEX = CAT_RPTR_OFFSET_S
+};
+
+enum FT817Squelch : byte				// CTCSS / DCS squelch
+{
+	FT817_SQL_DCS = CAT_SQL_DCS,
+	FT817_SQL_DCS_DECODE = CAT_SQL_DCS_DECD,
+	FT817_SQL_DCS_ENCODE = CAT_SQL_DCS_ENCD,
+	FT817_SQL_CTCSS = CAT_SQL_CTCSS,
+	FT817_SQL_CTCSS_DECODE = CAT_SQL_CTCSS_DECD,
+	FT817_SQL_CTCSS_ENCODE = CAT_SQL_CTCSS_ENCD,
+	FT817_SQL_OFF = CAT_SQL_OFF
+};
+
+enum FT817Tone : byte					// what squelchFreq() sets
+{
+	FT817_TONE_CTCSS = CAT_SQL_CTCSS_SET,
+	FT817_TONE_DCS = CAT_SQL_DCS_SET
+};
+
+// the bytes of answer to a command
+static inline constexpr byte ft817ReplySize(byte cmd)
+{
+	return cmd == CAT_RX_FREQ_CMD ? 5 : cmd == 0xBB ? 2 : 1;
+}
+
+// true if p1 is a valid parameter of a single frame command {p1,0,0,0,cmd}
+// with a single byte of answer, the ones with a freq or data in the frame
+// or a longer answer (the freq & mode, see getFreqMode()) are not single
+// ones; used to check command<>() at compile time and the modes of setMode()
+static inline constexpr bool ft817ValidCmd(byte cmd, byte p1)
+{
+	return cmd == CAT_MODE_SET ? (p1 < 0x05) | (p1 == CAT_MODE_WBFM) | (p1 == CAT_MODE_FM) |
+			(p1 == CAT_MODE_DIG) | (p1 == CAT_MODE_PKT) :
+		cmd == CAT_RPTR_OFFSET_CMD ? (p1 == FT817_OFFSET_MINUS) | (p1 == FT817_OFFSET_PLUS) |
+			(p1 == FT817_OFFSET_SIMPLEX) :
+		cmd == CAT_SQL_CMD ? (p1 == FT817_SQL_DCS) | (p1 == FT817_SQL_DCS_DECODE) |
+			(p1 == FT817_SQL_DCS_ENCODE) | (p1 == FT817_SQL_CTCSS) | (p1 == FT817_SQL_CTCSS_DECODE) |
+			(p1 == FT817_SQL_CTCSS_ENCODE) | (p1 == FT817_SQL_OFF) :
+		((cmd == CAT_LOCK_ON) | (cmd == CAT_LOCK_OFF) | (cmd == CAT_PTT_ON) | (cmd == CAT_PTT_OFF) |
+			(cmd == CAT_CLAR_ON) | (cmd == CAT_CLAR_OFF) | (cmd == CAT_VFO_AB) | (cmd == CAT_SPLIT_ON) |
+			(cmd == CAT_SPLIT_OFF) | (cmd == CAT_RX_DATA_CMD) | (cmd == CAT_TX_DATA_CMD)) & (p1 == 0);
+}
+
+// link timeout & retry policy, the defaults are the ones that work on a real
+// radio, define them before the build to tune them (see extras/host/retry-bench)
+#ifndef FT817_TIMEOUT
+	#define FT817_TIMEOUT		2000	// ms to wait for an answer byte from the radio
+#endif
+#ifndef FT817_EEPROM_READS
+	#define FT817_EEPROM_READS	4		// reads in readEEPROM() to get two matching ones in a row
+#endif
+#ifndef FT817_RETRIES
+	#define FT817_RETRIES		3		// extra tries of the EEPROM helpers when one fails
+#endif
+#ifndef FT817_FRESH
+	#define FT817_FRESH			1000	// ms a frequency read or set is trusted to tell the band
+#endif
+
+// a full status snapshot, see getState()
+struct FT817State
+{
+	unsigned long freq;		// in 10' of hz
+	byte mode;
+	bool tx;				// on TX
+	byte smeter;			// RX status (see notes in the header of this file)
+	byte pmeter;			// TX status, 0 on RX (see getPMeter())
+	bool vfo;				// 0 = A / 1 = B
+	byte bandA;				// bands (see notes in the header of this file)
+	byte bandB;
+	bool nar;				// of the current VFO
+	bool ipo;				// of the current VFO
+	bool breakIn;
+	bool keyer;
+	byte display;			// display selection
+};
 
 class FT817
 {
@@ -340,13 +430,25 @@ class FT817
 			void setSerial(SoftwareSerial portInfo);	// load the softserial into the FT817
 		#endif
 		void begin(unsigned int baud);						// set the baudrate of the softserial lib 
+		void setTap(FT817Tap *t);		// attach a traffic tap (ie. a FT817Trace), NULL to detach
+		#if FT817_WITH_EEPROM
+		void setWear(FT817Wear *w);		// attach a EEPROM wear governor (see ft817wear.h), NULL to detach
+		bool flushEEPROM();				// write the held writes that are due, true if some are still held
+		void setShadow(FT817Shadow *s);	// attach a EEPROM shadow (see ft817shadow.h), NULL to detach
+		bool warmStart();				// take the saved shadow after a few spot reads, or read it all if
+										// it's not good, returns true if it's live
+		bool refreshShadow();			// read the next pair of the shadow from the radio, true if it changed
+		#endif
 
+		#if FT817_WITH_SET
 		// toggles
 		void lock(boolean toggle);		// lock/unlock
 		void PTT(boolean toggle);		// ptt/un-ptt
 		void clar(boolean toggle);		// clar on / clar off
 		void split(boolean toggle);		// split / single
 		void toggleVFO();				// switch to the other VFO
+		#endif
+		#if FT817_WITH_EEPROM
 		bool toggleNar();				// toggle the narrow status for the current VFO, switching
 										// breifly to the other VFO and back, returns true is success
 		bool toggleIPO();				// toggle the IPO status for the current VFO, switching
@@ -354,76 +456,163 @@ class FT817
 		bool toggleBreakIn();			// toggle BreakIn
 		bool toggleKeyer();				// toggle Keyer status
 		bool toggleRfSql();				// toggle RF Gain/SQL control
+		#endif
 
+		#if FT817_WITH_SET
 		// set commands
 		void setFreq(unsigned long freq);		// in 10' of hz
 		void setMode(byte mode);		// in text
 		void clarFreq(unsigned long freq);		// 
-		void switchVFO(bool vfo);		// 0 = A / 1 = B, checks the actual VFO to know if need to change
-		void rptrOffset(char *ofst);	// "-" / "+" / "s"
+		bool setSplit(unsigned long rxFreq, unsigned long txFreq,
+			byte rxMode = FT817_MODE_KEEP, byte txMode = FT817_MODE_KEEP);	// RX in a VFO, TX in the other &
+													// split on, with a single VFO swap (they end swapped),
+													// returns true if the radio acked it all
+		void rptrOffset(FT817Offset offset);
 		void rptrOffsetFreq(unsigned long freq);
-		void squelch(char * mode);
-		void squelchFreq(unsigned int, char * sqlType);
+		void squelch(FT817Squelch mode);
+		void squelchFreq(unsigned int, FT817Tone type);
+		#endif
+		#if FT817_WITH_STRINGS
+		void rptrOffset(char *ofst);	// "-" / "+" / "s", same as above
+		void squelch(char * mode);		// "DCS" / "DDC" / "DEN" / "TSQ" / "TDC" / "TEN" / "OFF", same as above
+		void squelchFreq(unsigned int, char * sqlType);	// "C" / "D", same as above
+		#endif
+		#if FT817_WITH_EEPROM
+		void switchVFO(bool vfo);		// 0 = A / 1 = B, checks the actual VFO to know if need to change
 		void setKeyerSpeed(int speed);
+		#endif
 
 		// get commands
-		bool getVFO();					// return the actual VFO: 0 = A / 1 = B
 		byte getMode();					// return a byte with the mode
 		unsigned long getFreqMode();	// in 10' of hz
-		byte getBandVFO(bool);			// return the band (see notes in the header of this file)
 		bool chkTX();					// return true if the radio is in TX state
-		byte getDisplaySelection();		// return a number that represents the row (see notes in the header of this file)
 		byte getSMeter();				// as a byte (see notes in the header of this file)
 		byte getPMeter();				// as a byte (see notes in the header of this file)
+		#if FT817_WITH_EEPROM
+		bool getVFO();					// return the actual VFO: 0 = A / 1 = B
+		byte getBandVFO(bool);			// return the band (see notes in the header of this file)
+		byte getDisplaySelection();		// return a number that represents the row (see notes in the header of this file)
 		bool getNar();					// get the actual narrow status for the current VFO
 		bool getIPO();					// get the IPO status for the actual VFO
 		bool getBreakIn();				// get the Break In operation status
 		bool getKeyer();				// toggle Keyer
+		bool getState(FT817State *state);	// all of the above in the fewest round trips, returns
+											// eepromValidData (the EEPROM based fields are good)
+
+		// menu & configuration settings, all at once (see ft817eeprom.h)
+		bool readSettings(FT817Settings *settings);			// returns true if valid
+		bool writeSettings(const FT817Settings *settings);	// writes only the bytes that changed, then verifies them,
+															// returns true if all went well; the VFO & bands are kept
+
+		// generic access to the EEPROM fields (see ft817eeprom.h), the per VFO
+		// ones are for the current VFO, get() is only valid if eepromValidData
+		// is true, set() & toggle() return true if success
+		template <class F> byte get()
+		{
+			return getField(F::address, F::perVFO, F::shift, F::mask);
+		}
+		template <class F> bool set(byte value)
+		{
+			return updateField(F::address, F::perVFO, (byte)~F::mask, (byte)((value << F::shift) & F::mask), 0);
+		}
+		template <class F> bool toggle()
+		{
+			static_assert(F::width == 1, "only single bit fields can be toggled");
+			return updateField(F::address, F::perVFO, 0xFF, 0, F::mask);
+		}
 
 		// vars
 		bool eepromValidData = false;	// true of false of the last eeprom read will read 3 times
 										// if two give same values on a row we flag it as valid
+		#endif
+
+		// any single frame command with a constant parameter, checked at
+		// compile time (see ft817ValidCmd()), returns the byte of answer
+		//	radio.command<CAT_SQL_CMD, FT817_SQL_CTCSS>();
+		template <byte CMD, byte P1 = 0> byte command()
+		{
+			static_assert(ft817ValidCmd(CMD, P1), "not a single frame command or not a valid parameter for it");
+			return singleCmd(CMD, P1);
+		}
+
+		// frame API, the caller owns the frame & reply storage (5 bytes each)
+		// so there is no shared buffer, frames can be built in advance, kept
+		// queued and the replies decoded in place
+		static void frameCmd(byte *frame, byte cmd, byte p1 = 0);	// {p1,0x00,0x00,0x00,cmd}
+		static void frameFreq(byte *frame, unsigned long freq, byte cmd);	// freq in 10' of hz as BCD + cmd
+																	// (FT817_FREQ_FRAME for a constant one)
+		#if FT817_WITH_EEPROM
+		// only on a model with an EEPROM map (see ft817model.h)
+		static void frameReadEEPROM(byte *frame, unsigned int address);		// EEPROM read (0xBB)
+		static void frameWriteEEPROM(byte *frame, unsigned int address, byte data, byte next);	// EEPROM write (0xBC)
+		#endif
+		static unsigned long replyFreq(const byte *reply);	// decode the freq of a freq/mode reply, in 10' of hz
+		void sendFrame(const byte *frame);					// send the frame, stale RX bytes are discarded first
+		byte readReply(byte *reply, byte count);			// read count bytes of answer, returns the count received
+		bool replyReady(byte count);						// true if count bytes of answer are already in, never waits
+		byte transact(const byte *frame, byte *reply, byte count);	// send & read, returns the count received
+
+		// non blocking exchange: post() sends the frame and returns at once, the
+		// answer (ft817ReplySize() bytes) comes in meanwhile (by interrupts with
+		// FT817_UART_ISR, see ft817uart.h); replyDone() never waits
+		void post(const byte *frame);
+		bool replyDone();					// true when the answer is all in, or timed out
+		byte takeReply(byte *reply);		// get it, returns the count received
+		uint32_t replyAt = 0;				// millis() when the answer was complete, 0 before the first one
 
 	private:
 		// private & aux functions ands proceduies
-		void getBytes(byte count);		// get 5 bytes and place it on the buffer MSBF
 		byte getByte();					// get a single byte and return it
-		void flushRX();					// empty any char in the softserial buffer
-		void flushBuffer();				// zeroing the buffer
-		void sendCmd();					// send the commands in the buffer
-		byte singleCmd(int cmd);		// simplifies small cmds
-		unsigned long from_bcd_be();	// convert the first 4 bytes in buffer to a freq in 10' of hz
-		void to_bcd_be(unsigned long freq);		// get a freq in 10'of hz and place it on the buffer
-		bool calcVFOaddr();				// calc the VFO address and place it on the MSB/LSB address
-										// if calculations are correct eepromValidData will be true
-										// and that value will be returned also
-		void modAddr(int address, signed int variation);	// modify an address with the variation
-															// if address is zero load it from MSB/LSB
-		bool readEEPROM();				// read the eeprom, return bool, true if success, false otherwise
-										// eeprom address is read from the MSB & LSB variables
-										// it returns two bytes, that are loaded in actualByte & nextByte
-		bool writeEEPROM(byte data);	// write data (performs a read cycle inside to preserve nextByte)
-										// address is loaded from MSB/LSB, if all good return true
-										// it returns true if all gone OK and can verify the integrity of
-										// the wrote data.
-		bool getBitFromEEPROM(byte rbit);		// get a bit position from an eeprom address loaded in MSB/LSB
-		bool toggleBitFromEEPROM(byte rbit);	// toggle a bit position from an eeprom address loaded in MSB/LSB
-		bool getBitFromVFO(signed int offset, byte rbit);	// this is a nice trick, it will return the bit
-															// position you want in the actual VFO with an
-															// offset in bytes...
-		bool toggleBitFromVFO(signed int offset, byte rbit);	// this is another a nice trick, this will allow us to
-																// toggle any bit position in the offset byte for the actual
-																// base VFO
+		void flushRX();					// discard any stale char in the serial RX buffer
+		byte singleCmd(byte cmd, byte p1 = 0);	// simplifies small cmds
+		void writeFrame(const byte *frame);		// sendFrame() with no RX flush
+		#if FT817_WITH_SET
+		byte pipeline(const byte *frames, byte count);	// send count frames, ack paced unless FT817Traits::pipeline
+		#endif
+		#if FT817_WITH_EEPROM
+		bool calcVFOaddr(unsigned int *address, bool write = false);	// calc the VFO address and place it on address
+												// if calculations are correct eepromValidData will be true
+												// and that value will be returned also; for a write
+												// the band is always read from the radio
+		bool readEEPROM(unsigned int address, byte *data);	// read the eeprom, return bool, true if success, false otherwise
+															// it returns two bytes, the one at address & the next one
+		bool readEEPROMRetry(unsigned int address, byte *data);	// same as above with some insistence
+		bool readEEPROMSet(const unsigned int *address, byte *data, byte count);	// read a sorted set of addresses
+																					// with the fewest reads
+		bool readEEPROMRange(unsigned int address, byte *data, byte count);	// read count bytes from address
+		bool writeEEPROM(unsigned int address, byte data);	// write data (performs a read cycle inside to preserve the next byte)
+															// it returns true if all gone OK and can verify the integrity of
+															// the wrote data.
+		bool writeEEPROM(unsigned int address, byte data, byte next);	// same, with the next byte already known
+		bool readFromVFO(signed int offset, unsigned int *address, byte *data);	// read the byte at an offset of the
+																				// actual VFO, returns its address too
+		bool calcVFOaddrRetry(unsigned int *address, bool write = false);	// calcVFOaddr() with some insistence
+		byte getField(unsigned int address, bool perVFO, byte shift, byte mask);	// read a field, see get<>()
+		bool updateField(unsigned int address, bool perVFO, byte keep, byte put, byte flip);	// write a field as
+																	// ((old & keep) | put) ^ flip, through the wear governor
+		bool applyField(unsigned int address, bool vfo, byte mask, byte bits);	// write a byte as (old & mask) ^ bits,
+																	// skipped if no change, if vfo switching briefly
+																	// to the other VFO
+		bool shadowRead(unsigned int address, bool perVFO, byte *value);	// a byte from the shadow, if it's
+																	// live and has it
+		bool shadowSpot(unsigned int address);	// a single read of a pair, true if it's as in the shadow
+		bool shadowVFO(bool vfo);		// read the VFO bytes of the shadow, for the band in use
+		bool loadShadow();				// read all of the shadow
+		#endif
 
 		// vars
-		unsigned long freq;		// frequency data as a long
+		unsigned long freq;		// last frequency read
 		byte mode;					// last mode read
-		byte buffer[5];	// buffer used to TX and RX data to the radio
-		byte MSB;					// MSB of the eeprom address | both used to calculate the address of
-		byte LSB;					// LSB of the eeprom address | the eeprom
-		byte actualByte;			// Actual byte requested by any EEPROM read operation
-		byte nextByte;				// Next byte, aka: when you read or write you always get/set two bytes
-									// for some operations we need to know that byte
+		FT817Tap *tap = NULL;		// traffic tap, if any
+		#if FT817_WITH_EEPROM
+		bool freqValid = false;		// freq is the one of the actual VFO
+		uint32_t freqAt;			// millis() when freq was read or set
+		FT817Wear *wear = NULL;		// EEPROM wear governor, if any
+		FT817Shadow *shadow = NULL;	// EEPROM shadow, if any
+		#endif
+		byte expected = 0;			// bytes of answer of the post()ed frame
+		uint32_t postedAt = 0;
+		bool replyComplete = false;
 
 };
 
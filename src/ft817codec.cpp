@@ -0,0 +1,67 @@
+/*
+ft817codec.cpp BCD codec of the frequencies in the CAT frames
+
+See ft817codec.h
+
+*/
+
+#include <Arduino.h>
+#include "ft817codec.h"
+
+// the BCD byte of 0..99
+static const byte bcdPairs[100] PROGMEM = {
+	0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09,
+	0x10, 0x11, 0x12, 0x13, 0x14, 0x15, 0x16, 0x17, 0x18, 0x19,
+	0x20, 0x21, 0x22, 0x23, 0x24, 0x25, 0x26, 0x27, 0x28, 0x29,
+	0x30, 0x31, 0x32, 0x33, 0x34, 0x35, 0x36, 0x37, 0x38, 0x39,
+	0x40, 0x41, 0x42, 0x43, 0x44, 0x45, 0x46, 0x47, 0x48, 0x49,
+	0x50, 0x51, 0x52, 0x53, 0x54, 0x55, 0x56, 0x57, 0x58, 0x59,
+	0x60, 0x61, 0x62, 0x63, 0x64, 0x65, 0x66, 0x67, 0x68, 0x69,
+	0x70, 0x71, 0x72, 0x73, 0x74, 0x75, 0x76, 0x77, 0x78, 0x79,
+	0x80, 0x81, 0x82, 0x83, 0x84, 0x85, 0x86, 0x87, 0x88, 0x89,
+	0x90, 0x91, 0x92, 0x93, 0x94, 0x95, 0x96, 0x97, 0x98, 0x99};
+
+// 4 digits (0..9999) as 2 BCD bytes
+static void encodeHalf(uint16_t x, byte *bcd)
+{
+	// x / 100, 5243 / 2^19 ~ 1 / 100 is exact up to 43698
+	byte p = (byte)(((uint32_t)x * 5243U) >> 19);
+	bcd[0] = pgm_read_byte(&bcdPairs[p]);
+	bcd[1] = pgm_read_byte(&bcdPairs[x - p * 100]);
+}
+
+// 2 BCD bytes as 4 digits, t*16 + u is worth t*10 + u
+static uint16_t decodeHalf(const byte *bcd)
+{
+	return (bcd[0] - (bcd[0] >> 4) * 6) * 100 + (bcd[1] - (bcd[1] >> 4) * 6);
+}
+
+void ft817EncodeFreq(unsigned long freq, byte *bcd)
+{
+	// only 8 digits fit, of a bigger one the lower ones are kept as the
+	// classic way does; it's rare so a loop is cheaper than a division
+	while (freq >= 100000000UL) { freq -= 100000000UL; }
+
+	// freq / 10000 as (freq / 2048) * 0.2048, 13422 / 2^16 ~ 0.2048; it's
+	// off by one at most, the remainder tells
+	uint16_t hi = (uint16_t)(((uint32_t)(uint16_t)(freq >> 11) * 13422U) >> 16);
+	int32_t lo = (int32_t)(freq - (uint32_t)hi * 10000U);
+	if (lo < 0)
+	{
+		hi--;
+		lo += 10000;
+	}
+	else if (lo >= 10000)
+	{
+		hi++;
+		lo -= 10000;
+	}
+
+	encodeHalf(hi, bcd);
+	encodeHalf((uint16_t)lo, bcd + 2);
+}
+
+unsigned long ft817DecodeFreq(const byte *bcd)
+{
+	return decodeHalf(bcd) * 10000UL + decodeHalf(bcd + 2);
+}
@@ -0,0 +1,49 @@
+/*
+ft817codec.h BCD codec of the frequencies in the CAT frames
+
+The radio takes and gives frequencies as 8 BCD digits (4 bytes, the most
+significant first) in 10' of Hz: {0x01,0x40,0x70,0x00} is 14.070.00 MHz.
+
+The classic way, a %10 and a /10 per digit, is 8 long divisions, a software
+routine on the AVR. Here there are none:
+
+	encode: one multiply by a reciprocal (& a fix of one step) splits the
+			frequency in two halves of 4 digits, another one splits each
+			half in two digit pairs and a 100 bytes table (in flash) gives
+			the BCD byte of each pair
+	decode: each BCD byte is t*16 + u, so its value is the byte - t*6; two
+			pairs make a 16 bits half and one multiply joins the halves
+
+Both give the same bytes/values as the classic way for any input, see
+extras/host/codec-bench for the exhaustive check & timing.
+
+For a constant frequency the BCD is solved at compile time, to build frames
+with no code at all (in flash if you like):
+
+	const byte to20m[5] = FT817_FREQ_FRAME(1407000, CAT_FREQ_SET);
+	radio.sendFrame(to20m);
+
+*/
+
+#ifndef FT817_CODEC_h
+#define FT817_CODEC_h
+
+#include <Arduino.h>
+
+void ft817EncodeFreq(unsigned long freq, byte *bcd);	// 8 digits as 4 BCD bytes, only the
+														// lower 8 digits of a bigger one
+unsigned long ft817DecodeFreq(const byte *bcd);			// the value of 4 BCD bytes
+
+// the BCD of a frequency, as the 4 bytes of the frame MSB first, at compile
+// time for a constant one
+static inline constexpr uint32_t ft817BCD(unsigned long freq)
+{
+	return freq == 0 ? 0 : (ft817BCD(freq / 10) << 4) | (freq % 10);
+}
+
+// a whole frame (initializer) with a constant frequency
+#define FT817_FREQ_FRAME(freq, cmd) { \
+	(byte)(ft817BCD(freq) >> 24), (byte)(ft817BCD(freq) >> 16), \
+	(byte)(ft817BCD(freq) >> 8), (byte)ft817BCD(freq), (byte)(cmd) }
+
+#endif
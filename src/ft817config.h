@@ -0,0 +1,78 @@
+/*
+ft817config.h Build profiles of the ft817 library
+
+On a small AVR (an ATmega328 with 2 KB of RAM & 32 KB of flash) the whole
+library may be too much next to the rest of the sketch. Pick a profile
+(below or in the build flags) and what's not in it is not compiled at all:
+
+	FT817_PROFILE_READ	status reads only: getFreqMode(), getMode(), getSMeter(),
+						getPMeter(), chkTX(), command<>(), the frame API and
+						post()/replyDone(), so a FT817Poller works
+	FT817_PROFILE_CAT	plus all the CAT commands that change the radio (set*,
+						PTT, split, squelch, ...) and the FT817Tuner, but no
+						EEPROM access at all
+	FT817_PROFILE_FULL	all of it, the default
+
+Each profile is a set of switches (0/1), any of them can be defined on its
+own to get something in between:
+
+	FT817_WITH_SET		the commands that change the radio
+	FT817_WITH_EEPROM	the EEPROM calls: get<>()/set<>()/toggle<>(), the
+						toggleXYZ() & getXYZ() of the EEPROM fields, getState(),
+						the settings, the FT817Wear & FT817Shadow; needs FT817_WITH_SET
+						and a model with an EEPROM map
+	FT817_WITH_STRINGS	the char * versions of rptrOffset(), squelch() &
+						squelchFreq(), the typed ones are always there
+
+extras/host/size-report.sh lists the flash & RAM of each profile.
+
+The radio model is set here too, FT817_MODEL_817 (the default), _857 or
+_897, see ft817model.h; only the FT-817 has the EEPROM calls.
+
+*/
+
+#ifndef FT817_CONFIG_h
+#define FT817_CONFIG_h
+
+#define FT817_PROFILE_READ		1
+#define FT817_PROFILE_CAT		2
+#define FT817_PROFILE_FULL		3
+
+// uncomment one to use it
+// #define FT817_PROFILE FT817_PROFILE_READ
+// #define FT817_PROFILE FT817_PROFILE_CAT
+
+#ifndef FT817_PROFILE
+	#define FT817_PROFILE		FT817_PROFILE_FULL
+#endif
+
+#define FT817_MODEL_817			1
+#define FT817_MODEL_857			2
+#define FT817_MODEL_897			3
+
+// uncomment one to use it
+// #define FT817_MODEL FT817_MODEL_857
+// #define FT817_MODEL FT817_MODEL_897
+
+#ifndef FT817_MODEL
+	#define FT817_MODEL			FT817_MODEL_817
+#endif
+
+#ifndef FT817_WITH_SET
+	#define FT817_WITH_SET		(FT817_PROFILE >= FT817_PROFILE_CAT)
+#endif
+#ifndef FT817_WITH_EEPROM
+	#define FT817_WITH_EEPROM	((FT817_PROFILE >= FT817_PROFILE_FULL) && (FT817_MODEL == FT817_MODEL_817))
+#endif
+#ifndef FT817_WITH_STRINGS
+	#define FT817_WITH_STRINGS	FT817_WITH_SET
+#endif
+
+#if FT817_WITH_EEPROM && !FT817_WITH_SET
+	#error "FT817_WITH_EEPROM needs FT817_WITH_SET"
+#endif
+#if FT817_WITH_STRINGS && !FT817_WITH_SET
+	#error "FT817_WITH_STRINGS needs FT817_WITH_SET"
+#endif
+
+#endif
@@ -0,0 +1,159 @@
+/*
+ft817eeprom.h the EEPROM map of the FT-817 as compile time field descriptors
+
+Every setting the library reads or writes in the EEPROM is a row of the
+FT817_EEPROM_FIELDS table: its address (or the offset from the base address
+of the current VFO data), the lowest bit, the width in bits and if it's per
+VFO. Each row becomes a type (FT817_FIELD_<name>) to use with the generic
+calls of the FT817 class:
+
+	byte wpm = radio.get<FT817_FIELD_KEYER_SPEED>() + 4;
+	radio.set<FT817_FIELD_DISPLAY>(9);
+	radio.toggle<FT817_FIELD_NAR>();		// single bit fields only
+
+All of it is resolved at compile time: the calls end in the same EEPROM
+helpers with constant arguments, no table is kept in flash or RAM. The
+table is a X-macro, so other code (a snapshot planner, a cache, a host
+tool) can expand it to walk every field:
+
+	#define NAME(name, address, shift, width, perVFO) #name,
+	const char *names[] = { FT817_EEPROM_FIELDS(NAME) };
+
+The VFO data of each band is FT817_BAND_SIZE bytes long, for VFO A from
+FT817_VFO_BASE and for VFO B FT817_VFO_SIZE bytes later; see ft817VFOBase()
+
+Which of those band records is in use follows from the frequency, for the
+ham bands (and the broadcast & air ones) in FT817_BANDS ft817Band() tells it
+with no EEPROM read at all. The edges are the band plan of the manual, not
+checked on a real radio yet, so the library uses it for reads only.
+
+The menu & configuration bytes right before it (FT817_SETTINGS_START up to
+the VFO data) are kept in a FT817Settings struct to read & write them all
+at once (see readSettings() & writeSettings() in ft817.h), the fields of
+the table in there can be used on it the same way. Only those are typed:
+the other menu options are raw bytes in data[], not named until a row with
+their address & bits (checked on a radio) is added to the table:
+
+	FT817Settings s;
+	radio.readSettings(&s);
+	s.set<FT817_FIELD_KEYER>(1);
+	s.set<FT817_FIELD_KEYER_SPEED>(20 - 4);
+	radio.writeSettings(&s);			// only the bytes that changed
+
+*/
+
+#ifndef FT817_EEPROM_h
+#define FT817_EEPROM_h
+
+#include <Arduino.h>
+#include "ft817model.h"
+
+// the layout of the model, see ft817model.h
+#define FT817_VFO_BASE		FT817Traits::vfoBase	// VFO A, band 0 (160 M)
+#define FT817_VFO_SIZE		FT817Traits::vfoSize	// from VFO A to VFO B
+#define FT817_BAND_SIZE		FT817Traits::bandSize	// data of a band in a VFO
+
+// the base address of the data of a VFO (0 = A / 1 = B) in a band
+static inline constexpr unsigned int ft817VFOBase(bool vfo, byte band)
+{
+	return FT817_VFO_BASE + (vfo ? FT817_VFO_SIZE : 0) + band * FT817_BAND_SIZE;
+}
+
+template <unsigned int ADDRESS, byte SHIFT, byte WIDTH, bool PER_VFO>
+struct FT817Field
+{
+	static_assert(WIDTH >= 1 && SHIFT + WIDTH <= 8, "a field must fit in a byte");
+
+	static const unsigned int address = ADDRESS;	// absolute, or offset from the VFO base if perVFO
+	static const byte shift = SHIFT;
+	static const byte width = WIDTH;
+	static const bool perVFO = PER_VFO;
+	static const byte mask = (byte)(((1 << WIDTH) - 1) << SHIFT);
+
+	// the field value in the EEPROM byte & the byte with a new value in it
+	static constexpr byte decode(byte data) { return (data & mask) >> SHIFT; }
+	static constexpr byte encode(byte data, byte value) { return (data & ~mask) | ((value << SHIFT) & mask); }
+};
+
+// the FT-817 map: name, address / VFO offset, lowest bit, width, per VFO
+#define FT817_EEPROM_FIELDS(FIELD) \
+	FIELD(VFO,			0x55,	0,	1,	false)	/* 0 = A / 1 = B */ \
+	FIELD(BREAKIN,		0x58,	5,	1,	false) \
+	FIELD(KEYER,		0x58,	4,	1,	false) \
+	FIELD(BAND_A,		0x59,	0,	4,	false)	/* see getBandVFO() in ft817.h */ \
+	FIELD(BAND_B,		0x59,	4,	4,	false) \
+	FIELD(RFSQL,		0x5F,	7,	1,	false)	/* RF gain / SQL knob */ \
+	FIELD(KEYER_SPEED,	0x62,	0,	6,	false)	/* wpm - 4, bits 6-7 are the battery charge time */ \
+	FIELD(DISPLAY,		0x76,	0,	4,	false)	/* see getDisplaySelection() in ft817.h */ \
+	FIELD(NAR,			1,		4,	1,	true) \
+	FIELD(IPO,			2,		5,	1,	true)
+
+#define FT817_FIELD_TYPEDEF(name, address, shift, width, perVFO) \
+	typedef FT817Field<address, shift, width, perVFO> FT817_FIELD_##name;
+
+FT817_EEPROM_FIELDS(FT817_FIELD_TYPEDEF)
+
+// band, lowest & highest freq in 10' of Hz; the band record the radio uses
+// for a frequency in there, the code is the one of getBandVFO() in ft817.h;
+// 108 MHz is the first freq of the Air band (VOR), not the last of FM BCB
+#define FT817_BANDS(BAND) \
+	BAND(0,		180000UL,	200000UL)	/* 160 M */ \
+	BAND(1,		350000UL,	400000UL)	/* 75/80 M */ \
+	BAND(2,		700000UL,	730000UL)	/* 40 M */ \
+	BAND(3,		1010000UL,	1015000UL)	/* 30 M */ \
+	BAND(4,		1400000UL,	1435000UL)	/* 20 M */ \
+	BAND(5,		1806800UL,	1816800UL)	/* 17 M */ \
+	BAND(6,		2100000UL,	2145000UL)	/* 15 M */ \
+	BAND(7,		2489000UL,	2499000UL)	/* 12 M */ \
+	BAND(8,		2800000UL,	2970000UL)	/* 10 M */ \
+	BAND(9,		5000000UL,	5400000UL)	/* 6 M */ \
+	BAND(10,	7600000UL,	10799999UL)	/* FM BCB */ \
+	BAND(11,	10800000UL,	13700000UL)	/* Air */ \
+	BAND(12,	14400000UL,	14800000UL)	/* 2 M */ \
+	BAND(13,	43000000UL,	45000000UL)	/* UHF */
+
+#define FT817_BAND_NONE		0xFF	// not in a band of the table
+
+// the band of a frequency (in 10' of Hz) or FT817_BAND_NONE; outside the
+// table the record the radio picks is not known for sure. The ranges do not
+// overlap so at most one term counts, no branches nor table lookups, and
+// it's solved at compile time for a constant frequency
+#define FT817_BAND_TERM(band, low, high) ((freq >= low) & (freq <= high)) * (band + 1) +
+
+static inline constexpr byte ft817Band(unsigned long freq)
+{
+	return (byte)((FT817_BANDS(FT817_BAND_TERM) 0) - 1);
+}
+
+// the menu & configuration area
+#define FT817_SETTINGS_START	FT817Traits::settingsStart
+#define FT817_SETTINGS_SIZE		(FT817_VFO_BASE - FT817_SETTINGS_START)
+
+// the whole area, typed access only to the fields of FT817_EEPROM_FIELDS
+struct FT817Settings
+{
+	byte data[FT817_SETTINGS_SIZE];		// from FT817_SETTINGS_START
+
+	template <class F> byte get() const
+	{
+		static_assert(!F::perVFO && F::address >= FT817_SETTINGS_START &&
+			F::address < FT817_VFO_BASE, "not a field of the settings area");
+		return F::decode(data[F::address - FT817_SETTINGS_START]);
+	}
+	template <class F> void set(byte value)
+	{
+		static_assert(!F::perVFO && F::address >= FT817_SETTINGS_START &&
+			F::address < FT817_VFO_BASE, "not a field of the settings area");
+		data[F::address - FT817_SETTINGS_START] = F::encode(data[F::address - FT817_SETTINGS_START], value);
+	}
+};
+
+// the bits of the settings area that are radio state, not settings (the
+// actual VFO & the bands), writeSettings() leaves them as they are
+static inline constexpr byte ft817StateBits(unsigned int address)
+{
+	return address == FT817_FIELD_VFO::address ? FT817_FIELD_VFO::mask :
+		address == FT817_FIELD_BAND_A::address ? (byte)(FT817_FIELD_BAND_A::mask | FT817_FIELD_BAND_B::mask) : 0;
+}
+
+#endif
@@ -0,0 +1,68 @@
+/*
+ft817model.h Compile time traits of the radio models for the ft817 library
+
+The FT-817, FT-857 and FT-897 share the CAT frames, but not the EEPROM map
+nor the time they take to do things. Each model is a specialization of
+FT817Model<> with its EEPROM layout and its timing (there is no command
+table, they all take the same CAT commands), and the build uses the one of
+FT817_MODEL (see ft817config.h) as FT817Traits: all of it are constants, so
+the code is made for that model with no run time checks at all. That is
+one model per build: a binary drives a single model, a mixed fleet takes
+a build for each one.
+
+	#define FT817_MODEL FT817_MODEL_857		// or in the build flags
+
+A call the model can't take does not compile: the EEPROM ones (get<>(),
+toggleNar(), getState(), ...) and the EEPROM frame builders of the frame
+API are not there without an EEPROM map (see FT817_WITH_EEPROM).
+
+Only the FT-817 is known: its EEPROM map (ft817eeprom.h) and its timing.
+The FT-857 & FT-897 are placeholders, the CAT commands only and every
+FT-817 timing as is until they are measured on a real one: adding a model
+or tuning one is editing its traits here.
+
+*/
+
+#ifndef FT817_MODEL_h
+#define FT817_MODEL_h
+
+#include <Arduino.h>
+#include "ft817config.h"
+
+template <byte MODEL> struct FT817Model;
+
+template <> struct FT817Model<FT817_MODEL_817>
+{
+	// EEPROM layout
+	static constexpr bool eeprom = true;					// the map in ft817eeprom.h
+	static constexpr unsigned int settingsStart = 0x55;		// menu & configuration area
+	static constexpr unsigned int vfoBase = 0x7D;			// VFO A, band 0 (160 M)
+	static constexpr unsigned int vfoSize = 390;			// from VFO A to VFO B
+	static constexpr unsigned int bandSize = 26;			// data of a band in a VFO
+
+	// timing, ms
+	static constexpr byte vfoSettle = 200;		// after a VFO swap, before the next frame
+	static constexpr byte eepromWrite = 10;		// after an EEPROM write
+	static constexpr byte eepromReread = 20;	// between the reads of an EEPROM check
+	static constexpr byte byteGap = 5;			// between the bytes of an answer
+	static constexpr byte replyTail = 5;		// after the last one, not checked on a real radio if needed
+
+	// the frames of setSplit() back to back with the acks read after,
+	// instead of each one after the ack of the one before; only seen
+	// working on the simulator, so off until checked on a real radio
+	static constexpr bool pipeline = false;
+};
+
+// placeholders: no EEPROM map (yet), the same CAT commands & the FT-817 timing
+template <> struct FT817Model<FT817_MODEL_857> : FT817Model<FT817_MODEL_817>
+{
+	static constexpr bool eeprom = false;
+};
+
+template <> struct FT817Model<FT817_MODEL_897> : FT817Model<FT817_MODEL_857> { };
+
+typedef FT817Model<FT817_MODEL> FT817Traits;
+
+static_assert(FT817Traits::eeprom || !FT817_WITH_EEPROM, "there is no EEPROM map of this model, see ft817model.h");
+
+#endif
@@ -0,0 +1,162 @@
+/*
+ft817poll.cpp Adaptive polling of the radio status for the ft817 library
+
+See ft817poll.h
+
+*/
+
+#include <Arduino.h>
+#include "ft817poll.h"
+
+// the command of each field
+static const byte pollCmd[FT817_POLL_FIELDS] PROGMEM = {CAT_RX_FREQ_CMD, CAT_RX_DATA_CMD, CAT_TX_DATA_CMD};
+
+FT817Poller::FT817Poller()
+{
+	radio = NULL;
+	busy = FT817_POLL_FIELDS;
+	polls = timeouts = 0;
+	freq = 0;
+	mode = smeter = pmeter = 0;
+	tx = false;
+	for (byte i = 0; i < FT817_POLL_FIELDS; i++)
+	{
+		minMs[i] = interval[i] = FT817_POLL_MIN;
+		maxMs[i] = FT817_POLL_MAX;
+		known[i] = false;
+	}
+	maxMs[FT817_POLL_FREQ] = FT817_POLL_FREQ_MAX;
+}
+
+void FT817Poller::begin(FT817 &r)
+{
+	radio = &r;
+
+	// all of them right away
+	for (byte i = 0; i < FT817_POLL_FIELDS; i++) { due[i] = millis(); }
+}
+
+void FT817Poller::setRange(byte field, uint16_t fastest, uint16_t slowest)
+{
+	if (field >= FT817_POLL_FIELDS) { return; }
+
+	minMs[field] = fastest;
+	maxMs[field] = slowest;
+	interval[field] = constrain(interval[field], fastest, slowest);
+}
+
+bool FT817Poller::idle()
+{
+	return busy == FT817_POLL_FIELDS;
+}
+
+// a field changed, it and the freq at the fastest rate from now; the
+// others keep their pace, pulling them in too would only delay the freq
+// polls while tuning
+void FT817Poller::activity(byte field)
+{
+	uint32_t now = millis();
+	interval[field] = minMs[field];
+	interval[FT817_POLL_FREQ] = minMs[FT817_POLL_FREQ];
+	if ((int32_t)(due[FT817_POLL_FREQ] - now) > (int32_t)minMs[FT817_POLL_FREQ])
+	{
+		due[FT817_POLL_FREQ] = now + minMs[FT817_POLL_FREQ];
+	}
+}
+
+bool FT817Poller::take(byte field, const byte *reply)
+{
+	bool changed = !known[field];
+	known[field] = true;
+
+	switch (field)
+	{
+		case FT817_POLL_FREQ:
+		{
+			unsigned long f = FT817::replyFreq(reply);
+			changed |= (f != freq) | (reply[4] != mode);
+			freq = f;
+			mode = reply[4];
+			break;
+		}
+
+		case FT817_POLL_SMETER:
+		{
+			byte s = reply[0] & 0b00001111;
+			changed |= s != smeter;
+			smeter = s;
+			break;
+		}
+
+		case FT817_POLL_TX:
+		{
+			bool t = !bitRead(reply[0], 7);
+			byte p = t ? (reply[0] & 0b00001111) | (bitRead(reply[0], 6) ? 0b10000000 : 0) : 0;
+			changed |= (t != tx) | (p != pmeter);
+			tx = t;
+			pmeter = p;
+			break;
+		}
+	}
+
+	return changed;
+}
+
+byte FT817Poller::update()
+{
+	if (!radio) { return 0; }
+
+	byte changed = 0;
+	uint32_t now = millis();
+
+	// the answer of the one in flight
+	if (busy != FT817_POLL_FIELDS)
+	{
+		if (!radio->replyDone()) { return 0; }
+
+		byte reply[5];
+		byte field = busy;
+		busy = FT817_POLL_FIELDS;
+		now = millis();
+
+		if (radio->takeReply(reply) == ft817ReplySize(pgm_read_byte(&pollCmd[field])))
+		{
+			if (take(field, reply)) { changed = FT817_POLL_BIT(field); }
+		}
+		else
+		{
+			timeouts++;
+		}
+
+		// on a change (or while in TX) it goes fast, if not it slows down
+		if (changed || tx)
+		{
+			activity(field);
+		}
+		else
+		{
+			uint32_t slower = (uint32_t)interval[field] * 2;
+			interval[field] = slower > maxMs[field] ? maxMs[field] : slower;
+		}
+		due[field] = now + interval[field];
+	}
+
+	// the most overdue one, if any
+	byte next = FT817_POLL_FIELDS;
+	for (byte i = 0; i < FT817_POLL_FIELDS; i++)
+	{
+		if ((int32_t)(now - due[i]) < 0) { continue; }
+		if (next == FT817_POLL_FIELDS || (int32_t)(due[next] - due[i]) > 0) { next = i; }
+	}
+
+	if (next != FT817_POLL_FIELDS)
+	{
+		byte frame[5];
+		FT817::frameCmd(frame, pgm_read_byte(&pollCmd[next]));
+		radio->post(frame);
+		busy = next;
+		polls++;
+	}
+
+	return changed;
+}
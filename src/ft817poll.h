@@ -0,0 +1,86 @@
+/*
+ft817poll.h Adaptive polling of the radio status for the ft817 library
+
+Polling getFreqMode(), getSMeter() and chkTX() at a fixed rate keeps the
+link (and the CPU of both ends) busy even when nothing changes. FT817Poller
+polls each of them at its own pace: right after a change of one (the
+frequency moving, the S-meter moving, TX) it and the frequency go to their
+fastest rate, and each one that stays the same doubles its interval up to
+its slowest rate. The slowest rate of the frequency is kept low (200 ms)
+as the first step of a tuning waits for it, the others idle at 3.2 s. It never waits: a poll is sent with post() and the answer
+taken when it's in (see ft817.h), so call update() as often as you like.
+
+	FT817 radio;
+	FT817Poller poller;
+
+	setup()
+		radio.begin(9600);
+		poller.begin(radio);
+		poller.setRange(FT817_POLL_SMETER, 200, 5000);	// ms, optional
+
+	loop()
+		byte changed = poller.update();
+		if (changed & FT817_POLL_BIT(FT817_POLL_FREQ)) { showFreq(poller.freq, poller.mode); }
+
+While it's in use do not use the radio object for other calls between
+update()s unless idle() is true, the answers would get mixed.
+
+*/
+
+#ifndef FT817_POLL_h
+#define FT817_POLL_h
+
+#include <Arduino.h>
+#include "ft817.h"
+
+// the polled values
+#define FT817_POLL_FREQ			0	// freq & mode
+#define FT817_POLL_SMETER		1	// S-meter
+#define FT817_POLL_TX			2	// PTT & power meter
+#define FT817_POLL_FIELDS		3
+#define FT817_POLL_BIT(field)	(1 << (field))
+
+#ifndef FT817_POLL_MIN
+	#define FT817_POLL_MIN		100		// default fastest rate, ms between polls
+#endif
+#ifndef FT817_POLL_MAX
+	#define FT817_POLL_MAX		3200	// default slowest rate
+#endif
+#ifndef FT817_POLL_FREQ_MAX
+	#define FT817_POLL_FREQ_MAX	200		// default slowest rate of the freq & mode
+#endif
+
+class FT817Poller
+{
+	public:
+		FT817Poller();
+		void begin(FT817 &r);
+		void setRange(byte field, uint16_t minMs, uint16_t maxMs);	// fastest & slowest rate of a field
+		byte update();			// call it often, returns the FT817_POLL_BIT()s of the values that changed
+		bool idle();			// no poll waiting for its answer
+
+		// the values, good after the first poll of each
+		unsigned long freq;		// in 10' of Hz
+		byte mode;
+		byte smeter;			// 0-15
+		bool tx;
+		byte pmeter;			// as in getState()
+
+		// stats
+		unsigned long polls;				// frames sent
+		unsigned long timeouts;				// polls with no (full) answer
+		uint16_t interval[FT817_POLL_FIELDS];	// ms to the next poll of each now
+
+	private:
+		void activity(byte field);
+		bool take(byte field, const byte *reply);	// store a value, true if it changed
+
+		FT817 *radio;
+		uint16_t minMs[FT817_POLL_FIELDS];
+		uint16_t maxMs[FT817_POLL_FIELDS];
+		uint32_t due[FT817_POLL_FIELDS];	// millis() of the next poll
+		bool known[FT817_POLL_FIELDS];		// polled once at least
+		byte busy;							// the field waiting for its answer, FT817_POLL_FIELDS if none
+};
+
+#endif
@@ -0,0 +1,102 @@
+/*
+ft817shadow.cpp Persistent warm start copy of the radio EEPROM for the ft817 library
+
+See ft817shadow.h
+
+*/
+
+#include <Arduino.h>
+#include "ft817config.h"
+#include "ft817shadow.h"
+
+// only in the profiles with it, see ft817config.h
+#if FT817_WITH_EEPROM
+
+FT817Shadow::FT817Shadow()
+{
+	reset();
+	data.magic = 0;		// nothing loaded yet
+	dirty = false;
+}
+
+// a Fletcher-16 of everything before the check, the padding included (it's
+// zeroed by reset() and saved & loaded as is)
+static uint16_t shadowCheck(const FT817ShadowData *d)
+{
+	const byte *p = (const byte *)d;
+	byte a = 0;
+	byte b = 0;
+	for (size_t i = 0; i < offsetof(FT817ShadowData, check); i++)
+	{
+		a = (a + p[i]) % 255;
+		b = (b + a) % 255;
+	}
+
+	return ((uint16_t)b << 8) | a;
+}
+
+bool FT817Shadow::valid()
+{
+	return (data.magic == FT817_SHADOW_MAGIC) && (data.id == id) && (data.check == shadowCheck(&data));
+}
+
+void FT817Shadow::reset()
+{
+	memset(&data, 0, sizeof(data));
+	data.magic = FT817_SHADOW_MAGIC;
+	data.id = id;
+	data.band[0] = data.band[1] = FT817_BAND_NONE;
+	live = warm = false;
+	step = 0;
+	seal();
+}
+
+void FT817Shadow::seal()
+{
+	data.check = shadowCheck(&data);
+	dirty = true;
+}
+
+byte *FT817Shadow::find(unsigned int address)
+{
+	if ((address >= FT817_SETTINGS_START) && (address < FT817_SETTINGS_START + FT817_SETTINGS_SIZE))
+	{
+		return &data.settings.data[address - FT817_SETTINGS_START];
+	}
+
+	for (byte v = 0; v < 2; v++)
+	{
+		if (data.band[v] == FT817_BAND_NONE) { continue; }
+
+		unsigned int at = ft817VFOBase(v, data.band[v]) + FT817_SHADOW_VFO_AT;
+		if ((address >= at) && (address < at + FT817_SHADOW_VFO_BYTES)) { return &data.vfo[v][address - at]; }
+	}
+
+	return NULL;
+}
+
+void FT817Shadow::put(unsigned int address, byte value)
+{
+	byte *p = find(address);
+	if (p && (*p != value))
+	{
+		*p = value;
+		seal();
+	}
+}
+
+// the settings pairs with no radio state in them, one after the other
+unsigned int FT817Shadow::sample()
+{
+	unsigned int address;
+	do
+	{
+		data.sample = (data.sample + 1) % FT817_SHADOW_PAIRS;
+		address = FT817_SETTINGS_START + data.sample * 2;
+	} while (ft817StateBits(address) | ft817StateBits(address + 1));
+
+	seal();
+	return address;
+}
+
+#endif
@@ -0,0 +1,106 @@
+/*
+ft817shadow.h Persistent warm start copy of the radio EEPROM for the ft817 library
+
+After a power cycle the VFO, the bands, the per VFO flags and the settings
+are read again from the radio, every byte by two matching reads with its
+retries and delays: seconds before the first useful screen. A FT817Shadow
+keeps a copy of the bytes the library reads (the settings area, 0x55 on,
+and the NAR/IPO bytes of the band in use of each VFO) to save wherever the
+platform allows and load back on the next start:
+
+	FT817 radio;
+	FT817Shadow shadow;
+
+	setup()
+		radio.begin(9600);
+		EEPROM.get(0, shadow.data);		// the saved one, anything if none
+		radio.setShadow(&shadow);
+		radio.warmStart();				// a few spot reads, or a full read
+
+	loop()
+		if (millis() - refreshed > 1000)
+		{
+			radio.refreshShadow();		// a pair of bytes per call
+			refreshed = millis();
+		}
+		if (shadow.dirty)
+		{
+			EEPROM.put(0, shadow.data);	// writes only the bytes that changed
+			shadow.dirty = false;
+		}
+
+warmStart() takes the saved copy if the checksum, the layout and the radio
+id are good and a few single reads agree with it: a settings pair (other
+each start) that must be as saved, or it's another radio or the menus
+changed and all is read again; and the radio state (the VFO, the bands and
+the NAR/IPO of each VFO) that is taken as it comes if it changed meanwhile.
+A read that gives what was saved is as good as the two matching reads of
+readEEPROM(), so a warm start is 5 reads instead of ~25 verified ones.
+
+Once live the reads of those bytes (get<>(), the getXYZ() of the EEPROM
+fields, getState() & readSettings()) come from the shadow with no traffic,
+and every EEPROM read or write the library does updates it (before that
+they leave it alone, so a loaded copy is never mixed with what was read
+before warmStart() checked it, and a failed warmStart() clears its magic
+so it's not saved as a good one). But a change
+made on the front panel of the radio is only seen when refreshShadow()
+gets to it: each call reads a pair, every other call one of the radio state
+(the VFO, the bands or the NAR/IPO of the actual VFO, so a change there is
+seen in 6 calls at most) and all of it in FT817_SHADOW_STEPS calls. The
+writes always find the address from the radio, never from the shadow.
+
+Set "id" before warmStart() to tell a radio from another one if the
+controller moves between them (0 by default), on Linux see shadowfile.h
+in extras/host to keep it in a file.
+
+*/
+
+#ifndef FT817_SHADOW_h
+#define FT817_SHADOW_h
+
+#include <Arduino.h>
+#include "ft817eeprom.h"
+
+#define FT817_SHADOW_MAGIC		0x5D01	// changes with the layout of FT817ShadowData
+#define FT817_SHADOW_VFO_AT		1		// the VFO bytes kept, from the base: NAR & IPO
+#define FT817_SHADOW_VFO_BYTES	2
+#define FT817_SHADOW_SAMPLES	1		// settings pairs checked at a warm start
+#define FT817_SHADOW_PAIRS		(FT817_SETTINGS_SIZE / 2)
+#define FT817_SHADOW_STEPS		(2 * (FT817_SHADOW_PAIRS + 2))	// refreshShadow() calls to read it all
+
+// what's saved, plain bytes
+struct FT817ShadowData
+{
+	uint16_t magic;				// FT817_SHADOW_MAGIC
+	uint16_t id;				// the radio
+	FT817Settings settings;		// from FT817_SETTINGS_START
+	byte band[2];				// the band of the VFO bytes of each VFO, FT817_BAND_NONE if not known
+	byte vfo[2][FT817_SHADOW_VFO_BYTES];	// the VFO bytes of each VFO
+	byte sample;				// the next settings pair to check at a warm start
+	uint16_t check;				// of all the above
+};
+
+class FT817Shadow
+{
+	public:
+		FT817Shadow();
+		bool valid();				// data has a good checksum, layout & id
+
+		FT817ShadowData data;		// save it & load it back, see above
+		bool dirty = false;			// data changed since you cleared it
+		uint16_t id = 0;			// the radio, see above
+		bool live = false;			// good for this session, the reads come from it
+		bool warm = false;			// the last warmStart() took the saved one
+
+	private:
+		friend class FT817;
+		void reset();				// empty, for this radio
+		byte *find(unsigned int address);	// where the byte of an address is, NULL if not kept
+		void put(unsigned int address, byte value);
+		void seal();				// checksum & dirty, after a change
+		unsigned int sample();		// the address of the next settings pair to check
+
+		byte step = 0;				// of refreshShadow()
+};
+
+#endif
@@ -0,0 +1,100 @@
+/*
+ft817trace.cpp Serial traffic tap & binary trace recorder for the ft817 library
+
+See ft817trace.h for the trace format.
+
+*/
+
+#include <Arduino.h>
+#include "ft817trace.h"
+
+FT817Trace::FT817Trace()
+{
+	out = NULL;
+	last = 0;
+}
+
+// write the header and start recording
+void FT817Trace::begin(Print &o)
+{
+	out = &o;
+	out->write('F');
+	out->write('8');
+	out->write('T');
+	out->write('R');
+	out->write((byte)FT817_TRACE_VERSION);
+	out->write((byte)0x00);
+	last = millis();
+}
+
+// stop recording
+void FT817Trace::end()
+{
+	out = NULL;
+}
+
+// user mark
+void FT817Trace::mark(byte id)
+{
+	if (!out) { return; }
+	tag(FT817_TRACE_MARK);
+	out->write(id);
+}
+
+// a frame was sent
+void FT817Trace::tx(const byte *frame)
+{
+	if (!out) { return; }
+	tag(FT817_TRACE_TX);
+	out->write(frame, 5);
+}
+
+// a byte was received
+void FT817Trace::rx(byte data)
+{
+	if (!out) { return; }
+	tag(FT817_TRACE_RX);
+	out->write(data);
+}
+
+// no byte came
+void FT817Trace::timeout()
+{
+	if (!out) { return; }
+	tag(FT817_TRACE_TIMEOUT);
+	out->write((byte)FT817_TRACE_LOST_TIMEOUT);
+}
+
+// a stale byte was thrown away
+void FT817Trace::discard(byte data)
+{
+	if (!out) { return; }
+	tag(FT817_TRACE_TIMEOUT);
+	out->write((byte)FT817_TRACE_LOST_DISCARD);
+	out->write(data);
+}
+
+// write the tag byte with the type and the delta time since the last
+// record, if the delta does not fit in the tag it's appended as varint
+void FT817Trace::tag(byte type)
+{
+	unsigned long now = millis();
+	unsigned long delta = (uint32_t)(now - last);	// wraps as in the MCU
+	last = now;
+
+	if (delta < FT817_TRACE_DELTA_EXT)
+	{
+		out->write((byte)((type << 6) | delta));
+		return;
+	}
+
+	out->write((byte)((type << 6) | FT817_TRACE_DELTA_EXT));
+	delta -= FT817_TRACE_DELTA_EXT;
+	do
+	{
+		byte b = delta & 0x7F;
+		delta >>= 7;
+		if (delta) { b |= 0x80; }
+		out->write(b);
+	} while (delta);
+}
@@ -0,0 +1,99 @@
+/*
+ft817trace.h Serial traffic tap & binary trace recorder for the ft817 library
+
+The FT817 object can be given a "tap", any object derived from FT817Tap will
+be notified of every frame sent to the radio and every byte read back from it
+(or the absence of it when the radio does not answer in time), also the
+stale or late bytes thrown away before a frame is sent.
+
+FT817Trace is a tap that writes a compact binary trace to any Print object
+(a SD card file, a spare serial port, a file on Linux, etc.) that can be
+later replayed on a host with the tools in extras/host.
+
+TRACE FORMAT
+============
+
+Header (6 bytes):
+
+	'F','8','T','R', version, flags
+		version = FT817_TRACE_VERSION
+		flags   = 0x00 (reserved)
+
+Then a stream of records, each one starting with a tag byte:
+
+	0bTTDD_DDDD
+	- TT: record type
+		00 = TX, a 5 bytes frame follows
+		01 = RX, a single byte follows
+		10 = LOST, a kind byte follows:
+			0x00 = TIMEOUT, the radio did not answer
+			0x01 = DISCARD, a byte left from a previous answer (a
+				   duplicated or late one) was thrown away before a
+				   frame was sent, the byte follows
+		11 = MARK, a single user byte follows (see mark())
+	- DDDDDD: ms elapsed since the previous record (or the header)
+		0-62 = the delta itself
+		63   = the delta is >= 63 and (delta - 63) follows as a
+			   LEB128 varint (7 bits per byte, LSB first, bit 7 set
+			   means more bytes follow)
+
+So a typical RX byte takes just 2 bytes in the trace and a TX frame 6.
+
+Version 1 traces have no kind byte on a TIMEOUT and no DISCARD records, the
+host tools read both.
+
+*/
+
+#ifndef FT817_TRACE_h
+#define FT817_TRACE_h
+
+#include <Arduino.h>
+
+#define FT817_TRACE_VERSION		0x02
+
+// record types, as placed on the two upper bits of the tag byte
+#define FT817_TRACE_TX			0x00
+#define FT817_TRACE_RX			0x01
+#define FT817_TRACE_TIMEOUT		0x02	// LOST, with its kind byte
+#define FT817_TRACE_MARK		0x03
+#define FT817_TRACE_DISCARD		0x04	// not a tag, a LOST record of the DISCARD kind
+
+// kinds of a LOST record
+#define FT817_TRACE_LOST_TIMEOUT	0x00
+#define FT817_TRACE_LOST_DISCARD	0x01
+
+#define FT817_TRACE_DELTA_EXT	63		// delta field value that flags a varint
+
+// base class for any traffic tap, override what you need
+class FT817Tap
+{
+	public:
+		virtual ~FT817Tap() { }
+		virtual void tx(const byte *frame) { }		// a 5 bytes frame was sent to the radio
+		virtual void rx(byte data) { }				// a byte was read from the radio
+		virtual void timeout() { }					// a byte was expected but none came
+		virtual void discard(byte data) { }			// a stale byte was thrown away before a frame
+};
+
+// binary trace recorder
+class FT817Trace : public FT817Tap
+{
+	public:
+		FT817Trace();
+		void begin(Print &out);			// write the header and start recording to out
+		void end();						// stop recording, out is not touched anymore
+		void mark(byte id);				// place a user mark in the trace (ie. "test #3 starts here")
+
+		// tap interface
+		void tx(const byte *frame);
+		void rx(byte data);
+		void timeout();
+		void discard(byte data);
+
+	private:
+		void tag(byte type);			// write the tag byte and the delta time
+		Print *out;
+		unsigned long last;				// millis() of the last record
+};
+
+#endif
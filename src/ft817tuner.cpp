@@ -0,0 +1,113 @@
+/*
+ft817tuner.cpp Coalescing tuning channel for the ft817 library
+
+See ft817tuner.h
+
+*/
+
+#include <Arduino.h>
+#include "ft817tuner.h"
+
+// only in the profiles with it, see ft817config.h
+#if FT817_WITH_SET
+
+#define TUNER_IDLE		0
+#define TUNER_FREQ		1
+#define TUNER_MODE		2
+
+FT817Tuner::FT817Tuner()
+{
+	radio = NULL;
+	freqPending = modePending = false;
+	inFlight = TUNER_IDLE;
+	lag = maxLag = 0;
+	sent = coalesced = 0;
+}
+
+void FT817Tuner::begin(FT817 &r)
+{
+	radio = &r;
+}
+
+// just take note, the frame goes out from update()
+void FT817Tuner::tune(unsigned long f)
+{
+	if (freqPending) { coalesced++; }
+	freq = f;
+	freqPending = true;
+	requested = millis();
+}
+
+void FT817Tuner::tune(unsigned long f, byte m)
+{
+	// same valid modes as FT817::setMode()
+	if (ft817ValidCmd(CAT_MODE_SET, m))
+	{
+		mode = m;
+		modePending = true;
+	}
+	tune(f);
+}
+
+// send the latest, the mode first
+void FT817Tuner::send()
+{
+	byte frame[5];
+	if (modePending)
+	{
+		FT817::frameCmd(frame, CAT_MODE_SET, mode);
+		modePending = false;
+		inFlight = TUNER_MODE;
+	}
+	else
+	{
+		FT817::frameFreq(frame, freq, CAT_FREQ_SET);
+		freqPending = false;
+		inFlight = TUNER_FREQ;
+		inFlightFreq = freq;
+		inFlightRequested = requested;
+	}
+
+	radio->post(frame);
+	sent++;
+}
+
+bool FT817Tuner::update()
+{
+	if (!radio) { return false; }
+
+	if (inFlight != TUNER_IDLE)
+	{
+		// the ack (or the timeout) of the post()ed frame, taken with no
+		// wait at all
+		if (!radio->replyDone()) { return true; }
+
+		byte ack;
+		if (radio->takeReply(&ack))
+		{
+			if (inFlight == TUNER_FREQ)
+			{
+				lag = (uint32_t)(millis() - inFlightRequested);
+				if (lag > maxLag) { maxLag = lag; }
+			}
+		}
+		else
+		{
+			// lost, send it again unless there is a newer one
+			if (inFlight == TUNER_MODE) { modePending = true; }
+			if (inFlight == TUNER_FREQ && !freqPending)
+			{
+				freq = inFlightFreq;
+				requested = inFlightRequested;
+				freqPending = true;
+			}
+		}
+		inFlight = TUNER_IDLE;
+	}
+
+	if (modePending || freqPending) { send(); }
+
+	return inFlight != TUNER_IDLE;
+}
+
+#endif
@@ -0,0 +1,66 @@
+/*
+ft817tuner.h Coalescing tuning channel for the ft817 library
+
+A blocking setFreq() per rotary encoder step can't keep up with a fast
+knob: every intermediate step is sent and acknowledged and the radio lags
+seconds behind. FT817Tuner keeps only the latest requested frequency (and
+mode) and sends it as soon as the previous frame is acknowledged, without
+ever blocking: call tune() from the encoder code as often as you like and
+update() from the main loop.
+
+	FT817 radio;
+	FT817Tuner tuner;
+
+	setup()
+		radio.begin(9600);
+		tuner.begin(radio);
+
+	loop()
+		if (encoderMoved) { tuner.tune(freq); }
+		tuner.update();
+
+While the tuner is busy (update() returns true) do not use the radio
+object for other calls, the answers would get mixed.
+
+The lag from a request to the radio acknowledging it is kept in lag (the
+last one) and maxLag, both in ms; coalesced counts the requests replaced
+by a newer one before being sent.
+
+*/
+
+#ifndef FT817_TUNER_h
+#define FT817_TUNER_h
+
+#include <Arduino.h>
+#include "ft817.h"
+
+class FT817Tuner
+{
+	public:
+		FT817Tuner();
+		void begin(FT817 &r);
+		void tune(unsigned long freq);				// in 10' of hz, the latest wins
+		void tune(unsigned long freq, byte mode);	// same, with the mode (CAT_MODE_*)
+		bool update();								// call it often, returns true while busy
+
+		// stats
+		unsigned long lag;			// ms from the request to the ack of the last frequency applied
+		unsigned long maxLag;
+		unsigned long sent;			// frames sent
+		unsigned long coalesced;	// requests replaced before being sent
+
+	private:
+		void send();
+
+		FT817 *radio;
+		unsigned long freq;			// latest requested
+		byte mode;
+		bool freqPending;			// not sent yet
+		bool modePending;
+		byte inFlight;				// what we wait the ack of: 0 = nothing, 1 = freq, 2 = mode
+		unsigned long inFlightFreq;
+		uint32_t requested;			// millis() of the latest frequency request
+		uint32_t inFlightRequested;
+};
+
+#endif
@@ -0,0 +1,100 @@
+/*
+ft817uart.cpp Interrupt driven UART receive for the ft817 library (AVR)
+
+See ft817uart.h
+
+*/
+
+#include <Arduino.h>
+#include "ft817uart.h"
+
+#ifdef FT817_UART_ACTIVE
+
+#include <avr/interrupt.h>
+
+#if defined(USART_RX_vect)
+	#define FT817_UART_RX_vect	USART_RX_vect
+#else
+	#define FT817_UART_RX_vect	USART0_RX_vect
+#endif
+
+#define MASK	(FT817_UART_BUFFER - 1)
+
+// shared with the ISR
+static volatile byte buffer[FT817_UART_BUFFER];
+static volatile byte head = 0;			// written by the ISR
+static volatile byte tail = 0;			// written by read()
+static volatile byte want = 0;			// bytes of the answer still to come
+static volatile bool complete = false;
+static volatile uint32_t completeAt;
+
+FT817Uart ft817Uart;
+
+ISR(FT817_UART_RX_vect)
+{
+	byte data = UDR0;
+	byte next = (head + 1) & MASK;
+
+	// a full buffer drops the byte, as the core's Serial does
+	if (next != tail)
+	{
+		buffer[head] = data;
+		head = next;
+	}
+
+	if (want && --want == 0)
+	{
+		completeAt = millis();
+		complete = true;
+	}
+}
+
+void FT817Uart::begin(unsigned long baud, byte config)
+{
+	// double speed, like the core does, less baud rate error
+	UCSR0A = _BV(U2X0);
+	UBRR0 = (F_CPU / 4 / baud - 1) / 2;
+	UCSR0C = config;
+	UCSR0B = _BV(RXEN0) | _BV(TXEN0) | _BV(RXCIE0);
+}
+
+int FT817Uart::available()
+{
+	return (byte)(head - tail) & MASK;
+}
+
+int FT817Uart::read()
+{
+	if (head == tail) { return -1; }
+
+	byte data = buffer[tail];
+	tail = (tail + 1) & MASK;
+	return data;
+}
+
+// the TX is just 5 bytes a frame, no need of an interrupt for it
+size_t FT817Uart::write(byte data)
+{
+	while (!(UCSR0A & _BV(UDRE0))) { ; }
+	UDR0 = data;
+	return 1;
+}
+
+void FT817Uart::expect(byte count)
+{
+	noInterrupts();
+	want = count;
+	complete = false;
+	interrupts();
+}
+
+bool FT817Uart::done(uint32_t *at)
+{
+	noInterrupts();
+	bool c = complete;
+	if (c) { *at = completeAt; }
+	interrupts();
+	return c;
+}
+
+#endif
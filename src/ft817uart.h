@@ -0,0 +1,52 @@
+/*
+ft817uart.h Interrupt driven UART receive for the ft817 library (AVR)
+
+With the hardware serial the answers of the radio are normally collected
+by the library waiting in a loop. Define FT817_UART_ISR (below or in the
+build flags) and the library drives USART0 on its own: the RX interrupt
+puts each byte in a small buffer and counts the ones of the answer still
+expected, flagging it complete with the millis() of the last byte. So the
+sketch can send a frame with post(), do useful work meanwhile and just
+check replyDone() (see ft817.h), no spinning.
+
+It takes the place of the core's Serial, so the sketch can't use Serial
+at the same time (it's the link to the radio anyway); it needs an AVR with
+a USART0 (ATmega328P, ATmega2560, ...). Without it post() & replyDone()
+still work, polling the Serial buffer.
+
+*/
+
+#ifndef FT817_UART_h
+#define FT817_UART_h
+
+#include <Arduino.h>
+
+// uncomment to use it
+// #define FT817_UART_ISR
+
+#if defined(FT817_UART_ISR) && defined(__AVR__)
+
+#define FT817_UART_ACTIVE
+
+#ifndef UDR0
+	#error "FT817_UART_ISR needs a USART0"
+#endif
+
+#define FT817_UART_BUFFER	32		// RX bytes, a power of 2
+
+class FT817Uart
+{
+	public:
+		void begin(unsigned long baud, byte config);	// config as SERIAL_8N2
+		int available();
+		int read();						// -1 if none
+		size_t write(byte data);
+		void expect(byte count);		// start counting the bytes of an answer
+		bool done(uint32_t *at);		// true when they are all in, at gets the millis() of the last one
+};
+
+extern FT817Uart ft817Uart;
+
+#endif
+
+#endif
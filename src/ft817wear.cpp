@@ -0,0 +1,178 @@
+/*
+ft817wear.cpp EEPROM wear accounting & write governor for the ft817 library
+
+See ft817wear.h
+
+*/
+
+#include <Arduino.h>
+#include "ft817config.h"
+#include "ft817wear.h"
+
+// only in the profiles with it, see ft817config.h
+#if FT817_WITH_EEPROM
+
+FT817Wear::FT817Wear()
+{
+	stats.writes = stats.held = stats.merged = stats.refused = 0;
+	for (byte i = 0; i < FT817_WEAR_SLOTS; i++)
+	{
+		stats.slot[i].address = FT817_WEAR_FREE;
+		stats.slot[i].count = 0;
+		recent[i] = pending[i] = false;
+	}
+}
+
+unsigned long FT817Wear::count(unsigned int address)
+{
+	byte i = find(address, false);
+	return i < FT817_WEAR_SLOTS ? stats.slot[i].count : 0;
+}
+
+byte FT817Wear::waiting()
+{
+	byte n = 0;
+	for (byte i = 0; i < FT817_WEAR_SLOTS; i++) { n += pending[i]; }
+	return n;
+}
+
+// the slot of an address; a new one takes a free slot or the least
+// written one with nothing held. In there it takes over the count of the
+// one it evicts (no address out of the slots was written more, as it's the
+// least written) and as the last write the latest one of all the evicted
+// addresses: so a count is never less than the real writes of its address
+// and an address that comes back is not written again sooner than
+// "interval", with any number of addresses in turn
+byte FT817Wear::find(unsigned int address, bool add)
+{
+	byte victim = FT817_WEAR_SLOTS;
+	for (byte i = 0; i < FT817_WEAR_SLOTS; i++)
+	{
+		if (stats.slot[i].address == address) { return i; }
+		if (pending[i]) { continue; }
+		if (victim == FT817_WEAR_SLOTS || stats.slot[i].address == FT817_WEAR_FREE ||
+			(stats.slot[victim].address != FT817_WEAR_FREE && stats.slot[i].count < stats.slot[victim].count))
+		{
+			victim = i;
+		}
+	}
+
+	if (!add || victim == FT817_WEAR_SLOTS) { return FT817_WEAR_SLOTS; }
+
+	if (stats.slot[victim].address == FT817_WEAR_FREE)
+	{
+		stats.slot[victim].count = 0;
+		recent[victim] = false;
+	}
+	else
+	{
+		if (recent[victim] && (!goneRecent || (int32_t)(last[victim] - gone) > 0))
+		{
+			gone = last[victim];
+			goneRecent = true;
+		}
+		last[victim] = gone;
+		recent[victim] = goneRecent;
+	}
+	stats.slot[victim].address = address;
+	return victim;
+}
+
+// a write of (old & mask) ^ bits to address; on FT817_WEAR_NOW mask & bits
+// are the ones to write, merged with the held one if any
+byte FT817Wear::request(unsigned int address, bool vfo, byte *m, byte *b)
+{
+	// all the slots hold a write, it can't tell: refused until a
+	// flushEEPROM() frees one
+	byte i = find(address, true);
+	if (i == FT817_WEAR_SLOTS)
+	{
+		stats.refused++;
+		dirty = true;
+		return FT817_WEAR_REFUSED;
+	}
+
+	// the frame rewrites the next byte too, over the budget it can't go
+	if (budget && ((stats.slot[i].count >= budget) || (count(address + 1) >= budget)))
+	{
+		pending[i] = false;
+		stats.refused++;
+		dirty = true;
+		return FT817_WEAR_REFUSED;
+	}
+
+	// after the held one: ((x & m1) ^ b1) & m2 ^ b2 = (x & m1 & m2) ^ ((b1 & m2) ^ b2)
+	if (pending[i])
+	{
+		*b = (bits[i] & *m) ^ *b;
+		*m = mask[i] & *m;
+
+		// it undoes the held one
+		if ((*m == 0xFF) && (*b == 0))
+		{
+			pending[i] = false;
+			stats.merged++;
+			dirty = true;
+			return FT817_WEAR_HELD;
+		}
+	}
+
+	// too soon for it or the next byte, hold it
+	if (!cool(address) || !cool(address + 1))
+	{
+		if (!pending[i]) { stats.held++; }
+		pending[i] = true;
+		perVFO[i] = vfo;
+		mask[i] = *m;
+		bits[i] = *b;
+		dirty = true;
+		return FT817_WEAR_HELD;
+	}
+
+	pending[i] = false;
+	return FT817_WEAR_NOW;
+}
+
+// a write frame was sent, it wrote address and the next one
+void FT817Wear::wrote(unsigned int address)
+{
+	stats.writes++;
+	dirty = true;
+
+	touch(address);
+	touch(address + 1);
+}
+
+void FT817Wear::touch(unsigned int address)
+{
+	byte i = find(address, true);
+	if (i == FT817_WEAR_SLOTS) { return; }
+	stats.slot[i].count++;
+	last[i] = millis();
+	recent[i] = true;
+}
+
+// an address out of the slots takes the latest write of the evicted ones
+// when it comes back (see find()), so that's the one to go by
+bool FT817Wear::cool(unsigned int address)
+{
+	byte i = find(address, false);
+	if (i == FT817_WEAR_SLOTS) { return !goneRecent || (uint32_t)(millis() - gone) >= interval; }
+	return !recent[i] || (uint32_t)(millis() - last[i]) >= interval;
+}
+
+bool FT817Wear::due(byte *i)
+{
+	for (byte j = 0; j < FT817_WEAR_SLOTS; j++)
+	{
+		if (pending[j] && cool(stats.slot[j].address) && cool(stats.slot[j].address + 1))
+		{
+			*i = j;
+			return true;
+		}
+	}
+
+	return false;
+}
+
+#endif
@@ -0,0 +1,130 @@
+/*
+ft817wear.h EEPROM wear accounting & write governor for the ft817 library
+
+The set<>() / toggle<>() calls (so all the toggleXYZ() & setKeyerSpeed())
+write the EEPROM of the radio, and a buggy UI or a bouncing button can
+burn thousands of write cycles in a while. Give the radio a FT817Wear and:
+
+	- every EEPROM write frame sent is counted, in total and for the most
+	  written addresses; a frame writes two bytes (the one asked and the
+	  next one, rewritten as it is) so it counts for both
+	- an address written less than "interval" ms ago is not written again
+	  right away, nor is the one before it (its frame rewrites this one):
+	  the write is held and goes out later from flushEEPROM() once both
+	  bytes of its frame cool down
+	- a held write merges with the next ones to the same address, the ones
+	  that undo it (a bit toggled twice) leave nothing to write at all
+	- an address over "budget" writes (if set) is not written anymore, nor
+	  is the one before it
+
+	FT817 radio;
+	FT817Wear wear;
+
+	setup()
+		radio.begin(9600);
+		radio.setWear(&wear);
+
+	loop()
+		if (buttonPressed) { radio.toggleKeyer(); }
+		radio.flushEEPROM();		// the held writes that are due
+
+While a write is held a get<>() of it reads the old value from the radio.
+
+writeSettings() goes through it too, byte by byte (both bytes of each
+frame): a held byte goes out later from flushEEPROM() and a refused one
+makes it return false. The
+FT817Async coroutines of the host build (extras/host) don't, they write
+around it.
+
+With more addresses in turn than FT817_WEAR_SLOTS an address that gets a
+slot takes over the count of the one it evicts and, as its last write, the
+latest one of all the evicted addresses: the counts and the holds are on
+the safe side (a write may be held or refused when it was not needed,
+never the other way round). When all the slots hold a write a write to
+another address is refused, until a flushEEPROM() sends one.
+
+The counters are all in the "stats" struct, plain bytes, so to keep them
+across power cycles save it wherever the platform allows when "dirty" is
+set (not on every change, it's EEPROM too), i.e. on an AVR:
+
+	EEPROM.get(0, wear.stats);		// in setup()
+	...
+	if (wear.dirty && (millis() - saved) > 3600000UL)
+	{
+		EEPROM.put(0, wear.stats);
+		wear.dirty = false;
+		saved = millis();
+	}
+
+*/
+
+#ifndef FT817_WEAR_h
+#define FT817_WEAR_h
+
+#include <Arduino.h>
+
+#ifndef FT817_WEAR_SLOTS
+	#define FT817_WEAR_SLOTS		8		// addresses counted one by one
+#endif
+#ifndef FT817_WEAR_INTERVAL
+	#define FT817_WEAR_INTERVAL		5000	// ms between writes of the same address
+#endif
+
+#define FT817_WEAR_FREE			0xFFFF	// a slot not in use
+
+// what the governor says of a write
+#define FT817_WEAR_NOW			0		// write it
+#define FT817_WEAR_HELD			1		// held for later, or merged with a held one
+#define FT817_WEAR_REFUSED		2		// over the budget
+
+struct FT817WearSlot
+{
+	unsigned int address;		// FT817_WEAR_FREE if not in use
+	unsigned long count;		// write frames that wrote it (to it or the one before)
+};
+
+struct FT817WearStats
+{
+	unsigned long writes;		// EEPROM write frames sent (two bytes each)
+	unsigned long held;			// writes held back for later
+	unsigned long merged;		// held writes undone by a later one, never sent
+	unsigned long refused;		// writes over the budget
+	FT817WearSlot slot[FT817_WEAR_SLOTS];	// the most written addresses
+};
+
+class FT817Wear
+{
+	public:
+		FT817Wear();
+		unsigned long count(unsigned int address);	// writes of an address (0 if not in the slots)
+		byte waiting();								// writes held now
+
+		// policy
+		unsigned long interval = FT817_WEAR_INTERVAL;	// ms between writes of the same address
+		unsigned long budget = 0;						// max writes of an address, 0 = no limit
+
+		FT817WearStats stats;		// save it to keep the counts, see above
+		bool dirty = false;			// stats changed since you cleared it
+
+	private:
+		friend class FT817;
+		byte request(unsigned int address, bool perVFO, byte *mask, byte *bits);	// FT817_WEAR_*
+		void wrote(unsigned int address);	// a frame wrote it and the next one
+		void touch(unsigned int address);	// one byte written
+		bool cool(unsigned int address);	// not written in the last interval
+		bool due(byte *i);				// a held write that can go now, in slot i
+		byte find(unsigned int address, bool add);	// slot index, FT817_WEAR_SLOTS if none
+
+		// per slot, not saved: the last write and the held one, as
+		// new = (old & mask) ^ bits
+		uint32_t last[FT817_WEAR_SLOTS];
+		bool recent[FT817_WEAR_SLOTS];	// last is valid
+		bool pending[FT817_WEAR_SLOTS];
+		bool perVFO[FT817_WEAR_SLOTS];
+		byte mask[FT817_WEAR_SLOTS];
+		byte bits[FT817_WEAR_SLOTS];
+		uint32_t gone = 0;				// no address out of the slots was written after it
+		bool goneRecent = false;		// gone is valid
+};
+
+#endif